@@ -31,44 +31,91 @@ uint8_t DEFAULT_CONFIG_KEY[20] = {
   0x36, 0xf4, 0x58, 0xf9, 0xdb
 };
 
-bool validateMessage(uint8_t *message, uint8_t *hash, int messageLength, uint8_t messageType) {
+/* HMAC contexts keyed once at boot, indexed by messageType (MASTER after the last one) */
+#define MASTER_KEY_CONTEXT 3
+mbedtls_md_context_t keyContexts[4];
+
+void prepareKeyContext(mbedtls_md_context_t *ctx, const uint8_t *key);
+void getKeyedHMAC_SHA1(mbedtls_md_context_t *ctx, const uint8_t *message, int messageLength, uint8_t *outputHMAC);
+
+/**
+ * @brief Loads the keys and prepares the HMAC-SHA1 contexts, so each verification
+ * skips the key padding and the inner/outer key hashing
+ */
+void setupAuth() {
+  prepareKeyContext(&keyContexts[0], DEFAULT_ACCESS_KEY);
+  prepareKeyContext(&keyContexts[1], DEFAULT_SYNC_KEY);
+  prepareKeyContext(&keyContexts[2], DEFAULT_CONFIG_KEY);
+  prepareKeyContext(&keyContexts[MASTER_KEY_CONTEXT], DEFAULT_MASTER_KEY);
+}
+
+bool validateMessage(uint8_t *message, uint8_t *hash, int messageLength, int hashLength, uint8_t messageType) {
   bool validity = false;
   uint8_t computedHash[SHA1_HASH_LENGTH];
-  uint8_t *key;
+  mbedtls_md_context_t *ctx;
 
   switch(messageType) {
     case 0:
       /* MESSAGE_TYPE = ACCESS */
-      key = DEFAULT_ACCESS_KEY;
+      ctx = &keyContexts[0];
       break;
     case 1:
       /* MESSAGE_TYPE = SYNC */
-      key = DEFAULT_SYNC_KEY;
+      ctx = &keyContexts[1];
       break;
     case 2:
       /* MESSAGE_TYPE = CONFIG */
-      key = DEFAULT_CONFIG_KEY;
+      ctx = &keyContexts[2];
       break;
     case 3:
       /* MESSAGE_TYPE = DEBUG */
       return true;
       break;
+    default:
+      return false;
   }
 
+  /* truncated hashes are accepted down to 4 bytes */
+  if(hashLength < 4 || hashLength > SHA1_HASH_LENGTH) return false;
+
   /* validating the hashes */
-  getHMAC_SHA1(key, KEY_LENGTH, message, messageLength, computedHash);
-  validity = validateSignature(hash, computedHash);
+  getKeyedHMAC_SHA1(ctx, message, messageLength, computedHash);
+  validity = validateSignature(hash, computedHash, hashLength);
 
   /* trying the master key, if the previous keys failed */
   if(!validity) {
-    key = DEFAULT_MASTER_KEY;
-    getHMAC_SHA1(key, KEY_LENGTH, message, messageLength, computedHash);
-    validity = validateSignature(hash, computedHash);
+    getKeyedHMAC_SHA1(&keyContexts[MASTER_KEY_CONTEXT], message, messageLength, computedHash);
+    validity = validateSignature(hash, computedHash, hashLength);
   }
 
   return validity;
 }
 
+/**
+ * @brief Prepares a HMAC-SHA1 context keyed with the given key
+ * @param ctx The context to prepare
+ * @param key The secret key, KEY_LENGTH bytes long
+ */
+void prepareKeyContext(mbedtls_md_context_t *ctx, const uint8_t *key) {
+  const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA1);
+  mbedtls_md_init(ctx);
+  mbedtls_md_setup(ctx, md_info, 1);
+  mbedtls_md_hmac_starts(ctx, key, KEY_LENGTH);
+}
+
+/**
+ * @brief Computes the signature of the message with a context prepared by prepareKeyContext()
+ * @param ctx The keyed HMAC-SHA1 context
+ * @param message The payload message (header + body)
+ * @param messageLength The message length
+ * @param [out] outputHMAC The computed HMAC-SHA1 hash
+ */
+void getKeyedHMAC_SHA1(mbedtls_md_context_t *ctx, const uint8_t *message, int messageLength, uint8_t *outputHMAC) {
+  mbedtls_md_hmac_reset(ctx);
+  mbedtls_md_hmac_update(ctx, message, messageLength);
+  mbedtls_md_hmac_finish(ctx, outputHMAC);
+}
+
 /**
  * @brief Computes the signature of the message with the HMAC-SHA1 algorithm
  * @param key The secret key
@@ -97,11 +144,12 @@ void getHMAC_SHA1(
  * @brief Verifies if the HMAC-SHA1 signatures match
  * @param informedHash The informed hash
  * @param computedHash The computed hash
+ * @param hashLength The number of leading bytes to compare (the informed hash may be truncated)
  */
-bool validateSignature(uint8_t *informedHash, uint8_t *computedHash) {
+bool validateSignature(uint8_t *informedHash, uint8_t *computedHash, int hashLength) {
   bool validity = true;
   /* no breaks to prevent timing attacks */
-  for(int i = 0; i < SHA1_HASH_LENGTH; i++) {
+  for(int i = 0; i < hashLength; i++) {
     if(informedHash[i] != computedHash[i])
       validity = false;
   }
@@ -2,7 +2,8 @@
 
 #define KEY_LENGTH 20 
 
-bool validateMessage(uint8_t *message, uint8_t *hash, int messageLength, uint8_t messageType);
+void setupAuth();
+bool validateMessage(uint8_t *message, uint8_t *hash, int messageLength, int hashLength, uint8_t messageType);
 void getHMAC_SHA1(
   const uint8_t *key,
   int key_length,
@@ -10,5 +11,5 @@ void getHMAC_SHA1(
   int message_length,
   uint8_t *output_hmac
 );
-bool validateSignature(uint8_t *informedHash, uint8_t *computedHash);
+bool validateSignature(uint8_t *informedHash, uint8_t *computedHash, int hashLength);
 void printHMACSHA1(uint8_t *hash);
\ No newline at end of file
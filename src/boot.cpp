@@ -0,0 +1,142 @@
+#include <boot.h>
+#include <Arduino.h>
+
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+
+#define BOOT_METRIC_MAGIC 0xCA05B008
+
+typedef struct {
+  uint32_t magic;
+  unsigned int trackedBoots;
+  int64_t lastBootToScanReady;
+  int64_t worstBootToScanReady;
+  unsigned int verifiedScanBoots;
+  int64_t lastBootToFirstVerifiedScan;
+  int64_t worstBootToFirstVerifiedScan;
+} BootMetric;
+
+/* survives watchdog and brownout resets, so the metric is tracked across boots */
+RTC_NOINIT_ATTR BootMetric bootMetric;
+
+portMUX_TYPE bootPhasesMux = portMUX_INITIALIZER_UNLOCKED;
+BootPhase bootPhases[BOOT_MAX_PHASES];
+int bootPhasesCount = 0;
+int64_t scanReadyAt = -1;
+int64_t firstVerifiedScanAt = -1;
+bool verifiedScanSeen = false;
+
+void resetBootMetric();
+
+/**
+ * @brief Timestamps a boot phase. Can be called from any task
+ * @param name The phase name (must be a string literal)
+ */
+void markBootPhase(const char *name) {
+  int64_t timestamp = esp_timer_get_time();
+  portENTER_CRITICAL(&bootPhasesMux);
+  if(bootPhasesCount < BOOT_MAX_PHASES) {
+    bootPhases[bootPhasesCount].name = name;
+    bootPhases[bootPhasesCount].timestamp = timestamp;
+    bootPhasesCount++;
+  }
+  portEXIT_CRITICAL(&bootPhasesMux);
+}
+
+/**
+ * @brief Records the boot-to-scan-ready time: the first frame went through the detector.
+ * Only the first call after the boot counts
+ */
+void markScanReady() {
+  if(scanReadyAt >= 0) return;
+  scanReadyAt = esp_timer_get_time();
+  markBootPhase("scanReady");
+
+  if(bootMetric.magic != BOOT_METRIC_MAGIC) resetBootMetric();
+  bootMetric.trackedBoots++;
+  bootMetric.lastBootToScanReady = scanReadyAt;
+  if(scanReadyAt > bootMetric.worstBootToScanReady)
+    bootMetric.worstBootToScanReady = scanReadyAt;
+}
+
+/**
+ * @brief Records the boot-to-first-verified-scan time, only if the verified QR Code was
+ * captured within BOOT_FIRST_SCAN_WINDOW_MS of the scan being ready. A later scan means the
+ * user walked up after the boot, and its time would measure the user instead of the boot
+ * @param capturedAt The time the frame of the verified QR Code was captured, in microseconds
+ * @return True on the first verified scan after the boot and false otherwise
+ */
+bool markFirstVerifiedScan(int64_t capturedAt) {
+  if(verifiedScanSeen) return false;
+  verifiedScanSeen = true;
+  int64_t verifiedAt = esp_timer_get_time();
+  if(scanReadyAt < 0 || capturedAt > scanReadyAt + BOOT_FIRST_SCAN_WINDOW_MS * 1000LL) return true;
+
+  firstVerifiedScanAt = verifiedAt;
+  markBootPhase("firstVerifiedScan");
+  if(bootMetric.magic != BOOT_METRIC_MAGIC) resetBootMetric();
+  bootMetric.verifiedScanBoots++;
+  bootMetric.lastBootToFirstVerifiedScan = firstVerifiedScanAt;
+  if(firstVerifiedScanAt > bootMetric.worstBootToFirstVerifiedScan)
+    bootMetric.worstBootToFirstVerifiedScan = firstVerifiedScanAt;
+  return true;
+}
+
+/**
+ * @brief Clears the metric kept in the RTC memory, after a power-on or a layout change
+ */
+void resetBootMetric() {
+  bootMetric.magic = BOOT_METRIC_MAGIC;
+  bootMetric.trackedBoots = 0;
+  bootMetric.lastBootToScanReady = -1;
+  bootMetric.worstBootToScanReady = -1;
+  bootMetric.verifiedScanBoots = 0;
+  bootMetric.lastBootToFirstVerifiedScan = -1;
+  bootMetric.worstBootToFirstVerifiedScan = -1;
+}
+
+/**
+ * @brief Gets the boot-to-scan-ready time of the current boot
+ * @return The time in microseconds, or -1 if no frame went through the detector yet
+ */
+int64_t getBootToScanReady() {
+  return scanReadyAt;
+}
+
+/**
+ * @brief Gets the boot-to-first-verified-scan time of the current boot
+ * @return The time in microseconds, or -1 if no scan was verified yet, or if the first
+ * verified QR Code was captured after the BOOT_FIRST_SCAN_WINDOW_MS window
+ */
+int64_t getBootToFirstVerifiedScan() {
+  return firstVerifiedScanAt;
+}
+
+/**
+ * @brief Prints the reset reason, the boot phases timestamps and the tracked boot-to-scan-ready
+ * and boot-to-first-verified-scan metrics
+ */
+void printBootReport() {
+  Serial.print("resetReason: ");
+  Serial.println((int) esp_reset_reason());
+
+  Serial.println("boot phases (us):");
+  for(int i = 0; i < bootPhasesCount; i++) {
+    /* int64_t timestamps, a long is 32 bits on the ESP32 and wraps after ~35 minutes */
+    Serial.printf("  %s: %lld\n", bootPhases[i].name, (long long) bootPhases[i].timestamp);
+  }
+
+  Serial.printf("bootToScanReady: %lld\n", (long long) scanReadyAt);
+  Serial.printf("bootToFirstVerifiedScan: %lld\n", (long long) firstVerifiedScanAt);
+  if(bootMetric.magic == BOOT_METRIC_MAGIC) {
+    Serial.print("trackedBoots: ");
+    Serial.println(bootMetric.trackedBoots);
+    Serial.printf("lastBootToScanReady: %lld\n", (long long) bootMetric.lastBootToScanReady);
+    Serial.printf("worstBootToScanReady: %lld\n", (long long) bootMetric.worstBootToScanReady);
+    Serial.print("verifiedScanBoots: ");
+    Serial.println(bootMetric.verifiedScanBoots);
+    Serial.printf("lastBootToFirstVerifiedScan: %lld\n", (long long) bootMetric.lastBootToFirstVerifiedScan);
+    Serial.printf("worstBootToFirstVerifiedScan: %lld\n", (long long) bootMetric.worstBootToFirstVerifiedScan);
+  }
+}
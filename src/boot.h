@@ -0,0 +1,18 @@
+#include <stdint.h>
+
+#define BOOT_MAX_PHASES 12
+/* a verified scan only counts for the boot metric if its frame was captured this soon
+ * after the scan was ready, i.e. the QR Code was already in front of the camera */
+#define BOOT_FIRST_SCAN_WINDOW_MS 1000
+
+typedef struct {
+  const char *name;
+  int64_t timestamp;
+} BootPhase;
+
+void markBootPhase(const char *name);
+void markScanReady();
+bool markFirstVerifiedScan(int64_t capturedAt);
+int64_t getBootToScanReady();
+int64_t getBootToFirstVerifiedScan();
+void printBootReport();
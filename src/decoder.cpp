@@ -1,8 +1,18 @@
 #include <decoder.h>
 
-int getPayloadBodyLength(int payloadLength);
-int getPayloadMessageLength(int payloadLength);
-bool assertPayloadLength(int payloadLength, uint8_t messageType, uint8_t operationType);
+/*
+ * The payload decoding has no Arduino dependencies, so the same code decodes the
+ * payloads on the ESP32-CAM and in the host benchmark (tools/payload_bench.cpp).
+ * The Serial printing lives in decoderprint.cpp.
+ */
+
+#if V2_HASH_LENGTH < 4 || V2_HASH_LENGTH > HASH_LENGTH
+#error "V2_HASH_LENGTH must be between 4 and HASH_LENGTH bytes"
+#endif
+
+int getPayloadBodyLength(int payloadLength, int hashLength);
+int getPayloadMessageLength(int payloadLength, int hashLength);
+bool assertPayloadLength(uint8_t *payload, int payloadLength, uint8_t payloadVersion, uint8_t messageType, uint8_t operationType);
 
 uint8_t *rawPayloadPtr;
 int rawPayloadLength;
@@ -15,6 +25,7 @@ int rawPayloadLength;
  */
 DecodedQRCodeData getQRCodeData(uint8_t *payload, int payloadLength) {
     DecodedQRCodeData decodedQRCodeData = {
+        0,     /* uint8_t payloadVersion     */
         0,     /* uint8_t payloadHeader      */
         NULL,  /* uint8_t *payloadBody       */
         NULL,  /* uint8_t *payloadHash       */
@@ -31,24 +42,32 @@ DecodedQRCodeData getQRCodeData(uint8_t *payload, int payloadLength) {
         0,     /* int bodyLength             */
         0,     /* int messageLength          */
         false, /* bool needToAuthenticate    */
+        0,     /* int hashLength             */
     };
     /* raw qr code payload data */
     rawPayloadPtr = payload;
     rawPayloadLength = payloadLength;
     
+    /* the header must be present before any field is read */
+    if(payload == NULL || payloadLength < HEADER_LENGTH) {
+        return decodedQRCodeData;
+    }
+
     /* header fields */
     uint8_t payloadHeader = getPayloadHeader(payload);
+    uint8_t payloadVersion = getPayloadVersion(payloadHeader);
     uint8_t messageType = getMessageType(payloadHeader);
     uint8_t operationType = getOperationType(payloadHeader);
+    int hashLength = payloadVersion == 2 ? V2_HASH_LENGTH : HASH_LENGTH;
 
     /* if the payload length is not compatible with the expected length, abort with decodedQRCodeData */
-    if(!assertPayloadLength(payloadLength, messageType, operationType)) {
+    if(!assertPayloadLength(payload, payloadLength, payloadVersion, messageType, operationType)) {
         return decodedQRCodeData;
     }
 
     /* payload data fields */
-    uint8_t *payloadBody = getPayloadBody(payload, payloadLength);
-    uint8_t *payloadMessage = getPayloadMessage(payload, payloadLength);
+    uint8_t *payloadBody = getPayloadBody(payload, payloadLength, hashLength);
+    uint8_t *payloadMessage = getPayloadMessage(payload, payloadLength, hashLength);
     unsigned int userId = 0;
     unsigned int generatedAt = 0;
     unsigned int syncTime = 0;
@@ -60,8 +79,13 @@ DecodedQRCodeData getQRCodeData(uint8_t *payload, int payloadLength) {
     /* only extracts the important data from the body, based on the messageType */
     switch(messageType) {
         case MESSAGE_TYPE_ACCESS:
-            userId = getUserId(payloadBody);
-            generatedAt = getGeneratedAt(payloadBody);
+            if(payloadVersion == 2) {
+                userId = getUserIdV2(payloadBody);
+                generatedAt = getGeneratedAtV2(payloadBody);
+            } else {
+                userId = getUserId(payloadBody);
+                generatedAt = getGeneratedAt(payloadBody);
+            }
             break;
         case MESSAGE_TYPE_SYNC:
             syncTime = getSyncTime(payloadBody);
@@ -84,16 +108,17 @@ DecodedQRCodeData getQRCodeData(uint8_t *payload, int payloadLength) {
     uint8_t *payloadHash = NULL;
     if(messageType == MESSAGE_TYPE_ACCESS || messageType == MESSAGE_TYPE_SYNC || messageType == MESSAGE_TYPE_CONFIG) {
         /* extract only if the message type requires authentication */
-        payloadHash = getPayloadHash(payload, payloadLength);
+        payloadHash = getPayloadHash(payload, payloadLength, hashLength);
         needToAuthenticate = true;
     }
 
     /* metadata */
-    int bodyLength = getPayloadBodyLength(payloadLength);
-    int messageLength = getPayloadMessageLength(payloadLength);
+    int bodyLength = getPayloadBodyLength(payloadLength, hashLength);
+    int messageLength = getPayloadMessageLength(payloadLength, hashLength);
     bool successfulDecoding = true;
 
     /* writing the decoded data in the decodedQRCodeData struct */
+    decodedQRCodeData.payloadVersion = payloadVersion;
     decodedQRCodeData.payloadHeader = payloadHeader;
     decodedQRCodeData.payloadBody = payloadBody;
     decodedQRCodeData.payloadHash = payloadHash;
@@ -110,19 +135,29 @@ DecodedQRCodeData getQRCodeData(uint8_t *payload, int payloadLength) {
     decodedQRCodeData.bodyLength = bodyLength;
     decodedQRCodeData.messageLength = messageLength;
     decodedQRCodeData.needToAuthenticate = needToAuthenticate;
+    decodedQRCodeData.hashLength = hashLength;
 
     return decodedQRCodeData;
 }
 
 /**
- * @brief Checks if the payload length meets the required length for that messageType + operationType
+ * @brief Checks if the payload length meets the required length for that payloadVersion + messageType + operationType
+ * @param payload The payload uint8_t array
  * @param payloadLength The payload length
+ * @param payloadVersion The payloadVersion
  * @param messageType The messageType
  * @param operationType The operationType
  * @return True if the length is correct and false otherwise
  */
-bool assertPayloadLength(int payloadLength, uint8_t messageType, uint8_t operationType) {
+bool assertPayloadLength(uint8_t *payload, int payloadLength, uint8_t payloadVersion, uint8_t messageType, uint8_t operationType) {
     bool valid = true;
+    if(payloadVersion == 2) {
+        /* only ACCESS payloads have a v2 encoding: varint userId + 24-bit generatedAt + truncated hash */
+        if(messageType != MESSAGE_TYPE_ACCESS) return false;
+        int userIdLength = getVarintLength(payload + HEADER_LENGTH, payloadLength - HEADER_LENGTH);
+        if(userIdLength < 0) return false;
+        return payloadLength == HEADER_LENGTH + userIdLength + V2_DATETIME_LENGTH + V2_HASH_LENGTH;
+    }
     if(messageType == MESSAGE_TYPE_ACCESS && payloadLength != HEADER_LENGTH + 8 + HASH_LENGTH) return false;
     if(messageType == MESSAGE_TYPE_SYNC && payloadLength != HEADER_LENGTH + 4 + HASH_LENGTH) return false;
     if(messageType == MESSAGE_TYPE_CONFIG && payloadLength != HEADER_LENGTH + NEW_KEY_LENGTH + HASH_LENGTH) return false;
@@ -158,10 +193,11 @@ uint8_t getPayloadHeader(uint8_t *payload) {
  * @brief Extracts the body from the payload
  * @param payload The payload uint8_t array
  * @param payloadLength The payload size in bytes
+ * @param hashLength The hash size in bytes
  * @return The body of the payload
  */
-uint8_t *getPayloadBody(uint8_t *payload, int payloadLength) {
-    int bodySize = getPayloadBodyLength(payloadLength);
+uint8_t *getPayloadBody(uint8_t *payload, int payloadLength, int hashLength) {
+    int bodySize = getPayloadBodyLength(payloadLength, hashLength);
     uint8_t *body = (uint8_t *) malloc(bodySize * sizeof(uint8_t));
     for(int i = 0; i < bodySize; i++)
         body[i] = payload[i + HEADER_LENGTH];
@@ -172,12 +208,13 @@ uint8_t *getPayloadBody(uint8_t *payload, int payloadLength) {
  * @brief Extracts the hash from the payload
  * @param payload The payload uint8_t array
  * @param payloadLength The payload size in bytes
+ * @param hashLength The hash size in bytes
  * @return The hash of the payload
  */
-uint8_t *getPayloadHash(uint8_t *payload, int payloadLength) {
-    uint8_t *payloadHash = (uint8_t *) malloc(HASH_LENGTH * sizeof(uint8_t));
-    for(int i = 0; i < HASH_LENGTH; i++)
-        payloadHash[i] = payload[i + payloadLength - HASH_LENGTH];
+uint8_t *getPayloadHash(uint8_t *payload, int payloadLength, int hashLength) {
+    uint8_t *payloadHash = (uint8_t *) malloc(hashLength * sizeof(uint8_t));
+    for(int i = 0; i < hashLength; i++)
+        payloadHash[i] = payload[i + payloadLength - hashLength];
     return payloadHash;
 }
 
@@ -185,10 +222,11 @@ uint8_t *getPayloadHash(uint8_t *payload, int payloadLength) {
  * @brief Extracts the message (header + body) from the payload
  * @param payload The payload uint8_t array
  * @param payloadLength The payload size in bytes
+ * @param hashLength The hash size in bytes
  * @return The payload message
  */
-uint8_t *getPayloadMessage(uint8_t *payload, int payloadLength) {
-    int messageLength = getPayloadMessageLength(payloadLength);
+uint8_t *getPayloadMessage(uint8_t *payload, int payloadLength, int hashLength) {
+    int messageLength = getPayloadMessageLength(payloadLength, hashLength);
     uint8_t *payloadMessage = (uint8_t *) malloc((messageLength) * sizeof(uint8_t));
     for(int i = 0; i < messageLength; i++)
         payloadMessage[i] = payload[i];
@@ -198,10 +236,11 @@ uint8_t *getPayloadMessage(uint8_t *payload, int payloadLength) {
 /**
  * @brief Extract the length of the QR Code payload body
  * @param payloadLength the length of the payload
+ * @param hashLength the length of the hash
  * @return The body length
  */
-int getPayloadBodyLength(int payloadLength) {
-    int bodyLength = payloadLength - HEADER_LENGTH - HASH_LENGTH;
+int getPayloadBodyLength(int payloadLength, int hashLength) {
+    int bodyLength = payloadLength - HEADER_LENGTH - hashLength;
     if(bodyLength <= 0) bodyLength = payloadLength - HEADER_LENGTH;
     return bodyLength; 
 }
@@ -209,21 +248,32 @@ int getPayloadBodyLength(int payloadLength) {
 /**
  * @brief Extract the length of the QR Code payload message (header + body)
  * @param payloadLength the length of the payload
+ * @param hashLength the length of the hash
  * @return The message length
  */
-int getPayloadMessageLength(int payloadLength) {
-    int messageLength = payloadLength - HASH_LENGTH;
+int getPayloadMessageLength(int payloadLength, int hashLength) {
+    int messageLength = payloadLength - hashLength;
     if(messageLength <= 0) messageLength = payloadLength;
     return messageLength; 
 }
 
+/**
+ * @brief Extracts the payloadVersion from the QR Code payload header
+ * @param header The payload header
+ * @return 2 if the header has the PAYLOAD_VERSION_2_FLAG and 1 otherwise
+ */
+uint8_t getPayloadVersion(uint8_t header) {
+    if(header & PAYLOAD_VERSION_2_FLAG) return 2;
+    return 1;
+}
+
 /**
  * @brief Extracts the messageType from the QR Code payload header
  * @param header The payload header 
  * @return The messageType of the payload
  */
 uint8_t getMessageType(uint8_t header) {
-    uint8_t messageType = header >> 4;
+    uint8_t messageType = (header & ~PAYLOAD_VERSION_2_FLAG) >> 4;
     return messageType;
 }
 
@@ -265,6 +315,50 @@ unsigned int getGeneratedAt(uint8_t *body) {
     return generatedAt;
 }
 
+/**
+ * @brief Computes the length of a varint (LEB128, 7 bits per byte, least significant group first)
+ * @param data The varint bytes
+ * @param maxLength The number of bytes available
+ * @return The varint length, or -1 if it is not terminated within maxLength or overflows 32 bits
+ */
+int getVarintLength(uint8_t *data, int maxLength) {
+    for(int i = 0; i < VARINT_MAX_LENGTH && i < maxLength; i++) {
+        if((data[i] & 0x80) == 0) {
+            /* the 5th byte only has 4 bits left of a 32-bit value */
+            if(i == VARINT_MAX_LENGTH - 1 && data[i] > 0x0F) return -1;
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Extracts the varint userId from the v2 QR Code payload body
+ * @param body The payload body
+ * @return The userId of the payload body
+ */
+unsigned int getUserIdV2(uint8_t *body) {
+    unsigned int userId = 0;
+    for(int i = 0; i < VARINT_MAX_LENGTH; i++) {
+        userId = userId | (unsigned int) (body[i] & 0x7F) << 7 * i;
+        if((body[i] & 0x80) == 0) break;
+    }
+    return userId;
+}
+
+/**
+ * @brief Extracts the 24-bit generatedAt datetime from the v2 QR Code payload body
+ * @param body The payload body
+ * @return The generatedAt of the payload body, as a unix timestamp
+ */
+unsigned int getGeneratedAtV2(uint8_t *body) {
+    unsigned int delta = 0;
+    int offset = getVarintLength(body, VARINT_MAX_LENGTH);
+    for(int i = 0; i < V2_DATETIME_LENGTH; i++)
+        delta = delta << 8 | body[i + offset];
+    return V2_DATETIME_EPOCH + delta * V2_DATETIME_RESOLUTION;
+}
+
 /**
  * @brief Extracts the generatedAt datetime from the QR Code payload body
  * @param body The payload body
@@ -318,110 +412,3 @@ uint8_t *getNewKey(uint8_t *body) {
         newKey[i] = body[i];
     return newKey;
 }
-
-/**
- * @brief Prints the QR Code decoded data
- * @param decodedQRCodeData the DecodedQRCodeData struct
- */
-void printDecodedQRCodeData(DecodedQRCodeData decodedQRCodeData) {
-    uint8_t payloadHeader = decodedQRCodeData.payloadHeader;
-    uint8_t *payloadBody = decodedQRCodeData.payloadBody;
-    uint8_t *payloadHash = decodedQRCodeData.payloadHash;
-    uint8_t *payloadMessage = decodedQRCodeData.payloadMessage;
-    uint8_t messageType = decodedQRCodeData.messageType;
-    uint8_t operationType = decodedQRCodeData.operationType;
-    unsigned int userId = decodedQRCodeData.userId;
-    unsigned int generatedAt = decodedQRCodeData.generatedAt;
-    unsigned int syncTime = decodedQRCodeData.syncTime;
-    unsigned int debugBlink = decodedQRCodeData.debugBlink;
-    unsigned int debugSyncTime = decodedQRCodeData.debugSyncTime;
-    uint8_t *newKey = decodedQRCodeData.newKey;
-    bool successfulRead = decodedQRCodeData.successfulDecoding;
-    int bodyLength = decodedQRCodeData.bodyLength;
-    int messageLength = decodedQRCodeData.messageLength;
-
-    if(successfulRead == false) {
-      Serial.println("Unsuccessful QR Code read");
-      return;
-    } else {
-      Serial.println("QR Code decoded data:");
-    }
-
-    Serial.print("rawPayload: ");
-    if(rawPayloadPtr != NULL) {
-        for(int i = 0; i < rawPayloadLength; i++) {
-            Serial.print(rawPayloadPtr[i], HEX);
-            Serial.print(" ");
-        }
-        Serial.println();
-    } else {
-        Serial.println("NULL");
-    }
-
-    Serial.print("payloadHeader: ");
-    Serial.println(payloadHeader, HEX);
-
-    Serial.print("payloadBody: ");
-    if(payloadBody != NULL) {
-        for(int i = 0; i < bodyLength; i++) {
-            Serial.print(payloadBody[i], HEX);
-            Serial.print(" ");
-        }
-        Serial.println();
-    } else {
-        Serial.println("NULL");
-    }
-
-    Serial.print("payloadHash: ");
-    if(payloadHash != NULL) {
-        for(int i = 0; i < HASH_LENGTH; i++) {
-            Serial.print(payloadHash[i], HEX);
-            Serial.print(" ");
-        }
-        Serial.println();
-    } else {
-        Serial.println("NULL");
-    }
-
-    Serial.print("payloadMessage: ");
-    if(payloadMessage != NULL) {
-        for(int i = 0; i < bodyLength + HEADER_LENGTH; i++) {
-            Serial.print(payloadMessage[i], HEX);
-            Serial.print(" ");
-        }
-        Serial.println();
-    } else {
-        Serial.println("NULL");
-    }
-
-    Serial.print("messageType: ");
-    Serial.println(messageType);
-    Serial.print("operationType: ");
-    Serial.println(operationType);
-    Serial.print("userId: ");
-    Serial.println(userId);
-    Serial.print("generatedAt: ");
-    Serial.println(generatedAt);
-    Serial.print("syncTime: ");
-    Serial.println(syncTime);
-    Serial.print("debugBlink: ");
-    Serial.println(debugBlink);
-    Serial.print("debugSyncTime: ");
-    Serial.println(debugSyncTime);
-
-    Serial.print("newKey: ");
-    if(newKey != NULL) {
-        for(int i = 0; i < NEW_KEY_LENGTH; i++) {
-            Serial.print(newKey[i], HEX);
-            Serial.print(" ");
-        }
-        Serial.println();
-    } else {
-        Serial.println("NULL");
-    }
-
-    Serial.print("bodyLength: ");
-    Serial.println(bodyLength);
-    Serial.print("messageLength: ");
-    Serial.println(messageLength);
-}
\ No newline at end of file
@@ -1,6 +1,5 @@
 #include <stdint.h>
-#include <iostream>
-#include <Arduino.h>
+#include <stdlib.h>
 
 #define HEADER_LENGTH 1
 #define HASH_LENGTH 20
@@ -9,6 +8,14 @@
 #define INT_LENGTH 4
 #define NEW_KEY_LENGTH 20
 
+/* v2 payload encoding (compact ACCESS payloads) */
+#define PAYLOAD_VERSION_2_FLAG 0x80
+#define V2_HASH_LENGTH 8
+#define V2_DATETIME_LENGTH 3
+#define V2_DATETIME_EPOCH 1704067200 /* 2024-01-01 00:00:00 UTC */
+#define V2_DATETIME_RESOLUTION 60 /* seconds per unit, 24 bits cover ~31 years */
+#define VARINT_MAX_LENGTH 5
+
 /* message types */
 #define MESSAGE_TYPE_ACCESS 0
 #define MESSAGE_TYPE_SYNC 1
@@ -29,6 +36,7 @@
 #define OPERATION_BLINK_IF_SYNC = 1
 
 typedef struct {
+  uint8_t payloadVersion;
   uint8_t payloadHeader;
   uint8_t *payloadBody;
   uint8_t *payloadHash;
@@ -45,20 +53,25 @@ typedef struct {
   int bodyLength;
   int messageLength;
   bool needToAuthenticate;
+  int hashLength;
 } DecodedQRCodeData;
 
 DecodedQRCodeData getQRCodeData(uint8_t *payload, int payloadLength);
 void freeMallocData(DecodedQRCodeData *decodedQRCodeData);
 
 uint8_t getPayloadHeader(uint8_t *payload);
-uint8_t *getPayloadBody(uint8_t *payload, int payloadLength);
-uint8_t *getPayloadHash(uint8_t *payload, int payloadLength);
-uint8_t *getPayloadMessage(uint8_t *payload, int payloadLength);
+uint8_t *getPayloadBody(uint8_t *payload, int payloadLength, int hashLength);
+uint8_t *getPayloadHash(uint8_t *payload, int payloadLength, int hashLength);
+uint8_t *getPayloadMessage(uint8_t *payload, int payloadLength, int hashLength);
 
+uint8_t getPayloadVersion(uint8_t header);
 uint8_t getMessageType(uint8_t header);
 uint8_t getOperationType(uint8_t header);
 unsigned int getUserId(uint8_t *body);
 unsigned int getGeneratedAt(uint8_t *body);
+unsigned int getUserIdV2(uint8_t *body);
+unsigned int getGeneratedAtV2(uint8_t *body);
+int getVarintLength(uint8_t *data, int maxLength);
 unsigned int getSyncTime(uint8_t *body);
 unsigned int getDebugBlink(uint8_t *body);
 unsigned int getDebugSyncTime(uint8_t *body);
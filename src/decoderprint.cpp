@@ -0,0 +1,119 @@
+#include <decoder.h>
+#include <Arduino.h>
+
+/* the raw payload of the last getQRCodeData() call, kept by decoder.cpp */
+extern uint8_t *rawPayloadPtr;
+extern int rawPayloadLength;
+
+/**
+ * @brief Prints the QR Code decoded data
+ * @param decodedQRCodeData the DecodedQRCodeData struct
+ */
+void printDecodedQRCodeData(DecodedQRCodeData decodedQRCodeData) {
+    uint8_t payloadVersion = decodedQRCodeData.payloadVersion;
+    uint8_t payloadHeader = decodedQRCodeData.payloadHeader;
+    uint8_t *payloadBody = decodedQRCodeData.payloadBody;
+    uint8_t *payloadHash = decodedQRCodeData.payloadHash;
+    uint8_t *payloadMessage = decodedQRCodeData.payloadMessage;
+    uint8_t messageType = decodedQRCodeData.messageType;
+    uint8_t operationType = decodedQRCodeData.operationType;
+    unsigned int userId = decodedQRCodeData.userId;
+    unsigned int generatedAt = decodedQRCodeData.generatedAt;
+    unsigned int syncTime = decodedQRCodeData.syncTime;
+    unsigned int debugBlink = decodedQRCodeData.debugBlink;
+    unsigned int debugSyncTime = decodedQRCodeData.debugSyncTime;
+    uint8_t *newKey = decodedQRCodeData.newKey;
+    bool successfulRead = decodedQRCodeData.successfulDecoding;
+    int bodyLength = decodedQRCodeData.bodyLength;
+    int messageLength = decodedQRCodeData.messageLength;
+    int hashLength = decodedQRCodeData.hashLength;
+
+    if(successfulRead == false) {
+      Serial.println("Unsuccessful QR Code read");
+      return;
+    } else {
+      Serial.println("QR Code decoded data:");
+    }
+
+    Serial.print("rawPayload: ");
+    if(rawPayloadPtr != NULL) {
+        for(int i = 0; i < rawPayloadLength; i++) {
+            Serial.print(rawPayloadPtr[i], HEX);
+            Serial.print(" ");
+        }
+        Serial.println();
+    } else {
+        Serial.println("NULL");
+    }
+
+    Serial.print("payloadVersion: ");
+    Serial.println(payloadVersion);
+    Serial.print("payloadHeader: ");
+    Serial.println(payloadHeader, HEX);
+
+    Serial.print("payloadBody: ");
+    if(payloadBody != NULL) {
+        for(int i = 0; i < bodyLength; i++) {
+            Serial.print(payloadBody[i], HEX);
+            Serial.print(" ");
+        }
+        Serial.println();
+    } else {
+        Serial.println("NULL");
+    }
+
+    Serial.print("payloadHash: ");
+    if(payloadHash != NULL) {
+        for(int i = 0; i < hashLength; i++) {
+            Serial.print(payloadHash[i], HEX);
+            Serial.print(" ");
+        }
+        Serial.println();
+    } else {
+        Serial.println("NULL");
+    }
+
+    Serial.print("payloadMessage: ");
+    if(payloadMessage != NULL) {
+        for(int i = 0; i < bodyLength + HEADER_LENGTH; i++) {
+            Serial.print(payloadMessage[i], HEX);
+            Serial.print(" ");
+        }
+        Serial.println();
+    } else {
+        Serial.println("NULL");
+    }
+
+    Serial.print("messageType: ");
+    Serial.println(messageType);
+    Serial.print("operationType: ");
+    Serial.println(operationType);
+    Serial.print("userId: ");
+    Serial.println(userId);
+    Serial.print("generatedAt: ");
+    Serial.println(generatedAt);
+    Serial.print("syncTime: ");
+    Serial.println(syncTime);
+    Serial.print("debugBlink: ");
+    Serial.println(debugBlink);
+    Serial.print("debugSyncTime: ");
+    Serial.println(debugSyncTime);
+
+    Serial.print("newKey: ");
+    if(newKey != NULL) {
+        for(int i = 0; i < NEW_KEY_LENGTH; i++) {
+            Serial.print(newKey[i], HEX);
+            Serial.print(" ");
+        }
+        Serial.println();
+    } else {
+        Serial.println("NULL");
+    }
+
+    Serial.print("bodyLength: ");
+    Serial.println(bodyLength);
+    Serial.print("messageLength: ");
+    Serial.println(messageLength);
+    Serial.print("hashLength: ");
+    Serial.println(hashLength);
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include <dutycycle.h>
+
+/*
+ * The duty-cycle policy has no hardware dependencies, so the same code drives
+ * the low-power capture on the ESP32-CAM (power.cpp) and the host simulation
+ * (tools/dutycycle_sim.cpp).
+ */
+
+/**
+ * @brief Starts the duty cycle awake, with a full burst, so the first scan after the boot is not delayed
+ * @param policy The DutyCyclePolicy struct
+ * @param config The duty cycle timings
+ * @param now The current time in ms
+ */
+void startDutyCycle(DutyCyclePolicy *policy, DutyCycleConfig config, int64_t now) {
+  policy->config = config;
+  policy->awake = true;
+  policy->timerWake = false;
+  policy->decodedSinceWake = false;
+  policy->wokeAt = now;
+  policy->probeUntil = now;
+  policy->awakeUntil = now + config.burstMs;
+}
+
+/**
+ * @brief Wakes the duty cycle for a short probe, extended only if there is activity
+ * @param policy The DutyCyclePolicy struct
+ * @param now The current time in ms
+ */
+void onDutyCycleWake(DutyCyclePolicy *policy, int64_t now) {
+  policy->awake = true;
+  policy->timerWake = true;
+  policy->decodedSinceWake = false;
+  policy->wokeAt = now;
+  policy->probeUntil = now + policy->config.probeMs;
+  policy->awakeUntil = policy->probeUntil;
+}
+
+/**
+ * @brief Puts the duty cycle to sleep
+ * @param policy The DutyCyclePolicy struct
+ */
+void onDutyCycleSleep(DutyCyclePolicy *policy) {
+  policy->awake = false;
+}
+
+/**
+ * @brief Extends the burst after a frame change
+ * @param policy The DutyCyclePolicy struct
+ * @param now The current time in ms
+ */
+void onDutyCycleActivity(DutyCyclePolicy *policy, int64_t now) {
+  if(now + policy->config.burstMs > policy->awakeUntil)
+    policy->awakeUntil = now + policy->config.burstMs;
+}
+
+/**
+ * @brief Extends the burst after a decoded QR Code
+ * @param policy The DutyCyclePolicy struct
+ * @param capturedAt The time the decoded frame was captured, in ms
+ * @param now The current time in ms
+ * @return The wake-to-first-decode latency in ms, or -1 if the frame was not captured in the
+ * probe window of a timer wake (boot burst, burst extended by activity or not the first decode)
+ */
+int64_t onDutyCycleDecode(DutyCyclePolicy *policy, int64_t capturedAt, int64_t now) {
+  onDutyCycleActivity(policy, now);
+  if(!policy->timerWake || policy->decodedSinceWake) return -1;
+  policy->decodedSinceWake = true;
+  if(capturedAt > policy->probeUntil) return -1;
+  return now - policy->wokeAt;
+}
+
+/**
+ * @brief Checks if the burst is over
+ * @param policy The DutyCyclePolicy struct
+ * @param now The current time in ms
+ * @return True if the capture should sleep and false otherwise
+ */
+bool shouldDutyCycleSleep(DutyCyclePolicy *policy, int64_t now) {
+  if(policy->config.sleepMs <= 0) return false;
+  return policy->awake && now >= policy->awakeUntil;
+}
+
+/**
+ * @brief Simulates the duty-cycle policy over an arrival trace. A user in view changes the
+ * frame when arriving and leaving, and is decoded on the first frame captured while in view
+ * @param config The duty cycle timings
+ * @param simulation The capture timings
+ * @param arrivals The arrival trace, each user holding the QR Code in view for holdMs
+ * @param arrivalsCount The number of arrivals
+ * @param durationMs The simulated time
+ * @param [out] decodedAt The decode time of each arrival, or -1 if it was missed
+ * @return The DutyCycleReport struct
+ */
+DutyCycleReport simulateDutyCycle(
+  DutyCycleConfig config,
+  DutyCycleSimulation simulation,
+  const DutyCycleArrival *arrivals,
+  int arrivalsCount,
+  int64_t durationMs,
+  int64_t *decodedAt
+) {
+  DutyCycleReport report = {
+    0.0, /* double averageDuty               */
+    0,   /* int64_t awakeMs                  */
+    0,   /* int64_t totalMs                  */
+    0,   /* int decodedArrivals              */
+    0,   /* int missedArrivals               */
+    -1,  /* int64_t worstWakeToFirstDecodeMs */
+  };
+  DutyCyclePolicy policy;
+  int64_t now = 0;
+  bool wasPresent = false;
+
+  for(int i = 0; i < arrivalsCount; i++)
+    decodedAt[i] = -1;
+
+  startDutyCycle(&policy, config, now);
+  while(now < durationMs) {
+    if(!policy.awake) {
+      now += config.sleepMs;
+      onDutyCycleWake(&policy, now);
+      now += simulation.wakeMs;
+      report.awakeMs += simulation.wakeMs;
+      continue;
+    }
+
+    now += simulation.frameMs;
+    report.awakeMs += simulation.frameMs;
+
+    bool present = false;
+    for(int i = 0; i < arrivalsCount; i++) {
+      if(arrivals[i].arrivalMs > now || now >= arrivals[i].arrivalMs + arrivals[i].holdMs) continue;
+      present = true;
+      if(decodedAt[i] < 0) {
+        decodedAt[i] = now;
+        int64_t wakeToFirstDecode = onDutyCycleDecode(&policy, now - simulation.frameMs, now);
+        if(wakeToFirstDecode > report.worstWakeToFirstDecodeMs)
+          report.worstWakeToFirstDecodeMs = wakeToFirstDecode;
+      }
+    }
+    if(present != wasPresent) onDutyCycleActivity(&policy, now);
+    wasPresent = present;
+
+    if(shouldDutyCycleSleep(&policy, now)) onDutyCycleSleep(&policy);
+  }
+
+  for(int i = 0; i < arrivalsCount; i++) {
+    if(decodedAt[i] < 0) report.missedArrivals++;
+    else report.decodedArrivals++;
+  }
+  report.totalMs = now;
+  if(now > 0) report.averageDuty = (double) report.awakeMs / now;
+  return report;
+}
@@ -0,0 +1,56 @@
+#include <stdint.h>
+
+#define DEFAULT_DUTY_CYCLE_SLEEP_MS 600
+#define DEFAULT_DUTY_CYCLE_PROBE_MS 120
+#define DEFAULT_DUTY_CYCLE_BURST_MS 3000
+
+typedef struct {
+  int sleepMs;  /* light sleep between bursts, 0 disables the duty cycle */
+  int probeMs;  /* awake time after a wake, to look for a frame change */
+  int burstMs;  /* awake time after the last frame change or decode */
+} DutyCycleConfig;
+
+typedef struct {
+  DutyCycleConfig config;
+  bool awake;
+  bool timerWake;
+  bool decodedSinceWake;
+  int64_t wokeAt;
+  int64_t probeUntil;
+  int64_t awakeUntil;
+} DutyCyclePolicy;
+
+typedef struct {
+  int64_t arrivalMs;
+  int64_t holdMs;
+} DutyCycleArrival;
+
+typedef struct {
+  int frameMs;  /* time to capture and process one frame while awake */
+  int wakeMs;   /* light sleep exit + sensor standby exit until the first frame */
+} DutyCycleSimulation;
+
+typedef struct {
+  double averageDuty;
+  int64_t awakeMs;
+  int64_t totalMs;
+  int decodedArrivals;
+  int missedArrivals;
+  int64_t worstWakeToFirstDecodeMs;
+} DutyCycleReport;
+
+void startDutyCycle(DutyCyclePolicy *policy, DutyCycleConfig config, int64_t now);
+void onDutyCycleWake(DutyCyclePolicy *policy, int64_t now);
+void onDutyCycleSleep(DutyCyclePolicy *policy);
+void onDutyCycleActivity(DutyCyclePolicy *policy, int64_t now);
+int64_t onDutyCycleDecode(DutyCyclePolicy *policy, int64_t capturedAt, int64_t now);
+bool shouldDutyCycleSleep(DutyCyclePolicy *policy, int64_t now);
+
+DutyCycleReport simulateDutyCycle(
+  DutyCycleConfig config,
+  DutyCycleSimulation simulation,
+  const DutyCycleArrival *arrivals,
+  int arrivalsCount,
+  int64_t durationMs,
+  int64_t *decodedAt
+);
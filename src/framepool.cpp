@@ -0,0 +1,268 @@
+#include <framepool.h>
+#include <ESP32CameraPins.h>
+#include <Arduino.h>
+#include <boot.h>
+
+#include "esp_timer.h"
+
+#if FRAME_POOL_SIZE < 3
+#error "FRAME_POOL_SIZE must be at least 3 (one buffer for capture, one for detection, one ready)"
+#endif
+
+/* frames waiting for detection; the remaining buffers belong to capture and detection */
+#define READY_FRAMES_LENGTH (FRAME_POOL_SIZE - 2)
+
+void frameCaptureTask(void *pvParameters);
+void drainReadyFrames();
+
+QueueHandle_t readyFrames = NULL;
+TaskHandle_t frameCaptureTaskHandle = NULL;
+bool capturingFrames = true;
+/* set by the capture task once it is blocked on the pause, out of esp_camera_fb_get() */
+volatile bool captureIdle = false;
+/* frames captured before this time (esp_timer_get_time()) are given back unused */
+int64_t discardedBefore = 0;
+
+portMUX_TYPE framePoolStatsMux = portMUX_INITIALIZER_UNLOCKED;
+FramePoolStats framePoolStats = {
+  0, /* unsigned int framesCaptured  */
+  0, /* unsigned int framesReleased  */
+  0, /* unsigned int framesDropped   */
+  0, /* unsigned int framesInUse     */
+  0, /* unsigned int peakFramesInUse */
+  0, /* unsigned int captureStalls   */
+  0, /* unsigned int detectionStalls */
+};
+
+/**
+ * @brief Initializes the camera with FRAME_POOL_SIZE grayscale frame buffers in PSRAM
+ * and starts the capture task
+ * @return True if the camera was initialized and false otherwise
+ */
+bool setupFramePool() {
+  if(!psramFound()) {
+    return false;
+  }
+
+  /* created before the sensor init, so the detection can already block waiting for the first frame */
+  readyFrames = xQueueCreate(READY_FRAMES_LENGTH, sizeof(camera_fb_t *));
+
+  CameraPins pins = CAMERA_MODEL_AI_THINKER;
+  camera_config_t cameraConfig = {};
+  cameraConfig.ledc_channel = LEDC_CHANNEL_0;
+  cameraConfig.ledc_timer = LEDC_TIMER_0;
+  cameraConfig.pin_d0 = pins.Y2_GPIO_NUM;
+  cameraConfig.pin_d1 = pins.Y3_GPIO_NUM;
+  cameraConfig.pin_d2 = pins.Y4_GPIO_NUM;
+  cameraConfig.pin_d3 = pins.Y5_GPIO_NUM;
+  cameraConfig.pin_d4 = pins.Y6_GPIO_NUM;
+  cameraConfig.pin_d5 = pins.Y7_GPIO_NUM;
+  cameraConfig.pin_d6 = pins.Y8_GPIO_NUM;
+  cameraConfig.pin_d7 = pins.Y9_GPIO_NUM;
+  cameraConfig.pin_xclk = pins.XCLK_GPIO_NUM;
+  cameraConfig.pin_pclk = pins.PCLK_GPIO_NUM;
+  cameraConfig.pin_vsync = pins.VSYNC_GPIO_NUM;
+  cameraConfig.pin_href = pins.HREF_GPIO_NUM;
+  cameraConfig.pin_sscb_sda = pins.SIOD_GPIO_NUM;
+  cameraConfig.pin_sscb_scl = pins.SIOC_GPIO_NUM;
+  cameraConfig.pin_pwdn = pins.PWDN_GPIO_NUM;
+  cameraConfig.pin_reset = pins.RESET_GPIO_NUM;
+  cameraConfig.xclk_freq_hz = FRAME_POOL_XCLK_FREQ_HZ;
+  /* grayscale frames are read in place by the detector, no JPEG decoding or conversion */
+  cameraConfig.pixel_format = PIXFORMAT_GRAYSCALE;
+  cameraConfig.frame_size = FRAME_POOL_FRAME_SIZE;
+  cameraConfig.jpeg_quality = 15;
+  cameraConfig.fb_count = FRAME_POOL_SIZE;
+  cameraConfig.fb_location = CAMERA_FB_IN_PSRAM;
+  cameraConfig.grab_mode = CAMERA_GRAB_LATEST;
+
+  if(esp_camera_init(&cameraConfig) != ESP_OK) {
+    return false;
+  }
+
+  xTaskCreatePinnedToCore(frameCaptureTask, "frameCapture", 3 * 1024, NULL, 5, &frameCaptureTaskHandle, FRAME_POOL_CAPTURE_CORE);
+  return true;
+}
+
+/**
+ * @brief Stops capturing. The capture task returns the ready frames to the camera driver
+ */
+void pauseFramePool() {
+  capturingFrames = false;
+}
+
+/**
+ * @brief Waits for the capture task to stop after pauseFramePool(), so no esp_camera_fb_get()
+ * is in progress, e.g. before a light sleep
+ * @param timeoutMs The maximum time to wait
+ * @return True if the capture task is idle (or was never started) and false otherwise
+ */
+bool waitFramePoolIdle(int timeoutMs) {
+  if(frameCaptureTaskHandle == NULL) return true;
+  int64_t deadline = esp_timer_get_time() + timeoutMs * 1000LL;
+  while(!captureIdle) {
+    if(capturingFrames || esp_timer_get_time() > deadline) return false;
+    vTaskDelay(1);
+  }
+  return true;
+}
+
+/**
+ * @brief Discards the frames captured before a given time, e.g. frames left in the camera
+ * driver from before a light sleep
+ * @param timestamp The time in microseconds since the boot (esp_timer_get_time())
+ */
+void discardFramesBefore(int64_t timestamp) {
+  discardedBefore = timestamp;
+}
+
+/**
+ * @brief Resumes capturing, if paused
+ */
+void resumeFramePool() {
+  if(capturingFrames) return;
+  capturingFrames = true;
+  if(frameCaptureTaskHandle != NULL) xTaskNotifyGive(frameCaptureTaskHandle);
+}
+
+/**
+ * @brief Takes the oldest ready frame from the pool. The frame is lent by reference
+ * and must be given back with releaseFrame()
+ * @param timeoutMs The maximum time to wait for a frame
+ * @return The frame buffer, or NULL if no frame was ready in time
+ */
+camera_fb_t *acquireFrame(int timeoutMs) {
+  camera_fb_t *frame = NULL;
+  if(readyFrames == NULL) return NULL;
+  if(xQueueReceive(readyFrames, &frame, 0) == pdTRUE) return frame;
+
+  /* the detection is ahead of the capture. A paused pool (light sleep, suspended reading) is not a stall */
+  if(capturingFrames) {
+    portENTER_CRITICAL(&framePoolStatsMux);
+    framePoolStats.detectionStalls++;
+    portEXIT_CRITICAL(&framePoolStatsMux);
+  }
+  if(xQueueReceive(readyFrames, &frame, timeoutMs / portTICK_PERIOD_MS) == pdTRUE) return frame;
+  return NULL;
+}
+
+/**
+ * @brief Gives a frame back to the camera driver
+ * @param frame The frame buffer taken with acquireFrame()
+ */
+void releaseFrame(camera_fb_t *frame) {
+  if(frame == NULL) return;
+  esp_camera_fb_return(frame);
+  portENTER_CRITICAL(&framePoolStatsMux);
+  framePoolStats.framesReleased++;
+  framePoolStats.framesInUse--;
+  portEXIT_CRITICAL(&framePoolStatsMux);
+}
+
+/**
+ * @brief The frame capture task from the RTOS
+ */
+void frameCaptureTask(void *pvParameters) {
+  camera_fb_t *frame;
+  camera_fb_t *staleFrame;
+  int64_t captureStart;
+  bool firstFrame = true;
+  while(true) {
+    if(!capturingFrames) {
+      drainReadyFrames();
+      captureIdle = true;
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      captureIdle = false;
+      continue;
+    }
+
+    captureStart = esp_timer_get_time();
+    frame = esp_camera_fb_get();
+
+    /* the driver had no free buffer or no frame in time, the capture stalled */
+    if(frame == NULL || esp_timer_get_time() - captureStart > FRAME_POOL_STALL_MS * 1000) {
+      portENTER_CRITICAL(&framePoolStatsMux);
+      framePoolStats.captureStalls++;
+      portEXIT_CRITICAL(&framePoolStatsMux);
+    }
+    if(frame == NULL) continue;
+    /* the camera driver stamps the frames with esp_timer_get_time() */
+    if(frame->timestamp.tv_sec * 1000000LL + frame->timestamp.tv_usec < discardedBefore) {
+      esp_camera_fb_return(frame);
+      portENTER_CRITICAL(&framePoolStatsMux);
+      framePoolStats.framesDropped++;
+      portEXIT_CRITICAL(&framePoolStatsMux);
+      continue;
+    }
+    if(firstFrame) {
+      markBootPhase("firstFrame");
+      firstFrame = false;
+    }
+
+    portENTER_CRITICAL(&framePoolStatsMux);
+    framePoolStats.framesCaptured++;
+    framePoolStats.framesInUse++;
+    if(framePoolStats.framesInUse > framePoolStats.peakFramesInUse)
+      framePoolStats.peakFramesInUse = framePoolStats.framesInUse;
+    portEXIT_CRITICAL(&framePoolStatsMux);
+
+    /* the detection is behind: drop the oldest ready frame instead of blocking the capture */
+    if(uxQueueSpacesAvailable(readyFrames) == 0) {
+      if(xQueueReceive(readyFrames, &staleFrame, 0) == pdTRUE) {
+        releaseFrame(staleFrame);
+        portENTER_CRITICAL(&framePoolStatsMux);
+        framePoolStats.framesDropped++;
+        portEXIT_CRITICAL(&framePoolStatsMux);
+      }
+    }
+    xQueueSend(readyFrames, &frame, 0);
+  }
+}
+
+/**
+ * @brief Returns every frame waiting for detection to the camera driver
+ */
+void drainReadyFrames() {
+  camera_fb_t *frame;
+  while(xQueueReceive(readyFrames, &frame, 0) == pdTRUE) {
+    releaseFrame(frame);
+    portENTER_CRITICAL(&framePoolStatsMux);
+    framePoolStats.framesDropped++;
+    portEXIT_CRITICAL(&framePoolStatsMux);
+  }
+}
+
+/**
+ * @brief Gets a snapshot of the frame pool occupancy and stall counters
+ * @return The FramePoolStats struct
+ */
+FramePoolStats getFramePoolStats() {
+  FramePoolStats stats;
+  portENTER_CRITICAL(&framePoolStatsMux);
+  stats = framePoolStats;
+  portEXIT_CRITICAL(&framePoolStatsMux);
+  return stats;
+}
+
+/**
+ * @brief Prints the frame pool occupancy and stall counters
+ */
+void printFramePoolStats() {
+  FramePoolStats stats = getFramePoolStats();
+  Serial.print("framesCaptured: ");
+  Serial.println(stats.framesCaptured);
+  Serial.print("framesReleased: ");
+  Serial.println(stats.framesReleased);
+  Serial.print("framesDropped: ");
+  Serial.println(stats.framesDropped);
+  Serial.print("framesInUse: ");
+  Serial.print(stats.framesInUse);
+  Serial.print("/");
+  Serial.println(FRAME_POOL_SIZE);
+  Serial.print("peakFramesInUse: ");
+  Serial.println(stats.peakFramesInUse);
+  Serial.print("captureStalls: ");
+  Serial.println(stats.captureStalls);
+  Serial.print("detectionStalls: ");
+  Serial.println(stats.detectionStalls);
+}
@@ -0,0 +1,30 @@
+#include "esp_camera.h"
+#include <stdint.h>
+
+#define FRAME_POOL_SIZE 3
+#define FRAME_POOL_FRAME_SIZE FRAMESIZE_QVGA
+#define FRAME_POOL_XCLK_FREQ_HZ 10000000
+#define FRAME_POOL_CAPTURE_CORE 0
+#define FRAME_POOL_STALL_MS 100 /* a few frame periods at QVGA */
+
+typedef struct {
+  unsigned int framesCaptured;
+  unsigned int framesReleased;
+  unsigned int framesDropped;
+  unsigned int framesInUse;
+  unsigned int peakFramesInUse;
+  unsigned int captureStalls;
+  unsigned int detectionStalls;
+} FramePoolStats;
+
+bool setupFramePool();
+void pauseFramePool();
+bool waitFramePoolIdle(int timeoutMs);
+void resumeFramePool();
+void discardFramesBefore(int64_t timestamp);
+
+camera_fb_t *acquireFrame(int timeoutMs);
+void releaseFrame(camera_fb_t *frame);
+
+FramePoolStats getFramePoolStats();
+void printFramePoolStats();
@@ -0,0 +1,247 @@
+#include <power.h>
+#include <qrcode.h>
+#include <Arduino.h>
+
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+/* OV2640 COM2 register, in the sensor bank (bit 8 selects the bank for set_reg) */
+#define OV2640_COM2 0x109
+#define OV2640_COM2_STANDBY 0x10
+
+void lowPowerTask(void *pvParameters);
+void setSensorStandby(bool standby);
+int64_t getTimeMs();
+
+portMUX_TYPE lowPowerMux = portMUX_INITIALIZER_UNLOCKED;
+DutyCyclePolicy dutyCyclePolicy;
+DutyCycleConfig dutyCycleConfig = {
+  DEFAULT_DUTY_CYCLE_SLEEP_MS, /* int sleepMs */
+  DEFAULT_DUTY_CYCLE_PROBE_MS, /* int probeMs */
+  DEFAULT_DUTY_CYCLE_BURST_MS, /* int burstMs */
+};
+bool lowPowerCapture = false;
+TaskHandle_t lowPowerTaskHandle = NULL;
+int64_t lowPowerEnabledAt = 0;
+bool sensorStandby = false;
+
+/* subsampled copy of the last frame, for the frame change signal */
+uint8_t *referenceFrame = NULL;
+int referenceFrameLength = 0;
+
+LowPowerStats lowPowerStats = {
+  0,  /* unsigned int lightSleeps          */
+  0,  /* unsigned int rejectedSleeps       */
+  0,  /* int64_t sleptMs                   */
+  0,  /* int64_t enabledMs                 */
+  -1, /* int64_t lastWakeToFirstDecodeMs   */
+  -1, /* int64_t worstWakeToFirstDecodeMs  */
+};
+
+/**
+ * @brief Setups and enables the duty-cycled capture: the sensor goes to standby and the SoC
+ * to light sleep between capture bursts
+ * @param config The duty cycle timings
+ */
+void setupLowPowerCapture(DutyCycleConfig config) {
+  dutyCycleConfig = config;
+  enableLowPowerCapture();
+  if(lowPowerTaskHandle == NULL)
+    xTaskCreatePinnedToCore(lowPowerTask, "lowPower", 3 * 1024, NULL, 2, &lowPowerTaskHandle, 0);
+}
+
+/**
+ * @brief Enables the duty-cycled capture, starting with a full burst
+ */
+void enableLowPowerCapture() {
+  portENTER_CRITICAL(&lowPowerMux);
+  startDutyCycle(&dutyCyclePolicy, dutyCycleConfig, getTimeMs());
+  lowPowerEnabledAt = getTimeMs();
+  lowPowerStats.lightSleeps = 0;
+  lowPowerStats.rejectedSleeps = 0;
+  lowPowerStats.sleptMs = 0;
+  lowPowerCapture = true;
+  portEXIT_CRITICAL(&lowPowerMux);
+}
+
+/**
+ * @brief Disables the duty-cycled capture, the camera keeps capturing continuously
+ */
+void disableLowPowerCapture() {
+  lowPowerCapture = false;
+}
+
+/**
+ * @brief The duty cycle task from the RTOS
+ */
+void lowPowerTask(void *pvParameters) {
+  bool asleep;
+  int64_t sleepStart;
+  int64_t wokeAt;
+  esp_err_t sleepResult;
+  while(true) {
+    vTaskDelay(DUTY_CYCLE_POLL_MS / portTICK_PERIOD_MS);
+    if(!lowPowerCapture) {
+      /* the low-power mode was disabled while the sensor was in standby */
+      if(sensorStandby && isQRCodeReading()) {
+        setSensorStandby(false);
+        resumeFramePool();
+      }
+      continue;
+    }
+
+    portENTER_CRITICAL(&lowPowerMux);
+    if(shouldDutyCycleSleep(&dutyCyclePolicy, getTimeMs())) onDutyCycleSleep(&dutyCyclePolicy);
+    asleep = !dutyCyclePolicy.awake;
+    portEXIT_CRITICAL(&lowPowerMux);
+    if(!asleep) continue;
+
+    /* the ready frames are dropped, they would be stale after the sleep. The capture task may be
+     * blocked in esp_camera_fb_get() with the DMA running, so the sleep waits for it to stop */
+    pauseFramePool();
+    if(!waitFramePoolIdle(DUTY_CYCLE_IDLE_TIMEOUT_MS)) {
+      if(isQRCodeReading()) resumeFramePool();
+      continue;
+    }
+    setSensorStandby(true);
+    Serial.flush();
+
+    sleepStart = getTimeMs();
+    esp_sleep_enable_timer_wakeup((uint64_t) dutyCycleConfig.sleepMs * 1000);
+    sleepResult = esp_light_sleep_start();
+    /* stamped before the sensor wakes up, so the sleep exit and the SCCB writes count in the latency */
+    wokeAt = getTimeMs();
+
+    /* a rejected sleep (e.g. a wakeup source already pending) did not happen and is not counted.
+     * The capture still wakes up for a probe, so the reader is not blind if the sleep keeps failing */
+    portENTER_CRITICAL(&lowPowerMux);
+    if(sleepResult == ESP_OK) {
+      lowPowerStats.lightSleeps++;
+      lowPowerStats.sleptMs += wokeAt - sleepStart;
+    } else {
+      lowPowerStats.rejectedSleeps++;
+    }
+    portEXIT_CRITICAL(&lowPowerMux);
+
+    /* a suspended reader keeps the sensor in standby and skips the probe, the policy stays asleep */
+    if(!isQRCodeReading()) continue;
+
+    setSensorStandby(false);
+    /* frames left in the driver from before the sleep would be decoded as if just captured */
+    discardFramesBefore(wokeAt * 1000);
+    resumeFramePool();
+    portENTER_CRITICAL(&lowPowerMux);
+    onDutyCycleWake(&dutyCyclePolicy, wokeAt);
+    portEXIT_CRITICAL(&lowPowerMux);
+  }
+}
+
+/**
+ * @brief Puts the OV2640 in standby (or wakes it up), keeping its registers
+ * @param standby True to put the sensor in standby and false to wake it up
+ */
+void setSensorStandby(bool standby) {
+  sensor_t *sensor = esp_camera_sensor_get();
+  if(sensor == NULL || standby == sensorStandby) return;
+  sensor->set_reg(sensor, OV2640_COM2, OV2640_COM2_STANDBY, standby ? OV2640_COM2_STANDBY : 0);
+  sensorStandby = standby;
+}
+
+/**
+ * @brief Computes the cheap frame change signal: the mean absolute difference between a
+ * subsampled grid of the frame and the same grid of the previous frame. Must be called
+ * before the QR Code detection, which thresholds the frame in place
+ * @param frame The grayscale frame buffer
+ * @return True if the frame changed more than FRAME_CHANGE_THRESHOLD gray levels and false otherwise
+ */
+bool checkFrameChange(camera_fb_t *frame) {
+  int columns = frame->width / FRAME_CHANGE_STEP;
+  int rows = frame->height / FRAME_CHANGE_STEP;
+  int samples = columns * rows;
+  long difference = 0;
+  bool newReference = false;
+
+  if(samples == 0 || frame->len != frame->width * frame->height) return false;
+  if(referenceFrame == NULL || referenceFrameLength != samples) {
+    free(referenceFrame);
+    referenceFrame = (uint8_t *) malloc(samples * sizeof(uint8_t));
+    referenceFrameLength = samples;
+    newReference = true;
+  }
+
+  for(int y = 0; y < rows; y++) {
+    for(int x = 0; x < columns; x++) {
+      uint8_t pixel = frame->buf[y * FRAME_CHANGE_STEP * frame->width + x * FRAME_CHANGE_STEP];
+      difference += abs(pixel - referenceFrame[y * columns + x]);
+      referenceFrame[y * columns + x] = pixel;
+    }
+  }
+
+  if(newReference) return false;
+  return difference / samples > FRAME_CHANGE_THRESHOLD;
+}
+
+/**
+ * @brief Reports a processed frame to the duty cycle, extending the burst on activity
+ * @param frameChanged The checkFrameChange() result of the frame
+ * @param decoded True if a QR Code was decoded from the frame
+ * @param capturedAtMs The time the frame was captured, in ms
+ */
+void reportCaptureActivity(bool frameChanged, bool decoded, int64_t capturedAtMs) {
+  if(!lowPowerCapture) return;
+  int64_t now = getTimeMs();
+  portENTER_CRITICAL(&lowPowerMux);
+  if(frameChanged) onDutyCycleActivity(&dutyCyclePolicy, now);
+  if(decoded) {
+    int64_t wakeToFirstDecode = onDutyCycleDecode(&dutyCyclePolicy, capturedAtMs, now);
+    if(wakeToFirstDecode >= 0) {
+      lowPowerStats.lastWakeToFirstDecodeMs = wakeToFirstDecode;
+      if(wakeToFirstDecode > lowPowerStats.worstWakeToFirstDecodeMs)
+        lowPowerStats.worstWakeToFirstDecodeMs = wakeToFirstDecode;
+    }
+  }
+  portEXIT_CRITICAL(&lowPowerMux);
+}
+
+/**
+ * @brief Gets a snapshot of the duty cycle counters
+ * @return The LowPowerStats struct
+ */
+LowPowerStats getLowPowerStats() {
+  LowPowerStats stats;
+  portENTER_CRITICAL(&lowPowerMux);
+  stats = lowPowerStats;
+  stats.enabledMs = getTimeMs() - lowPowerEnabledAt;
+  portEXIT_CRITICAL(&lowPowerMux);
+  return stats;
+}
+
+/**
+ * @brief Prints the duty cycle counters and the measured duty
+ */
+void printLowPowerStats() {
+  LowPowerStats stats = getLowPowerStats();
+  Serial.print("lightSleeps: ");
+  Serial.println(stats.lightSleeps);
+  Serial.print("rejectedSleeps: ");
+  Serial.println(stats.rejectedSleeps);
+  Serial.printf("sleptMs: %lld\n", (long long) stats.sleptMs);
+  Serial.print("duty: ");
+  if(stats.enabledMs > 0) {
+    Serial.println(1.0 - (double) stats.sleptMs / stats.enabledMs, 3);
+  } else {
+    Serial.println("NULL");
+  }
+  Serial.print("lastWakeToFirstDecodeMs: ");
+  Serial.println((long) stats.lastWakeToFirstDecodeMs);
+  Serial.print("worstWakeToFirstDecodeMs: ");
+  Serial.println((long) stats.worstWakeToFirstDecodeMs);
+}
+
+/**
+ * @brief Gets the time since the boot, in ms, including the time spent in light sleep
+ * @return The time in ms
+ */
+int64_t getTimeMs() {
+  return esp_timer_get_time() / 1000;
+}
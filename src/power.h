@@ -0,0 +1,27 @@
+#include "esp_camera.h"
+#include <dutycycle.h>
+#include <stdint.h>
+
+#define FRAME_CHANGE_STEP 16
+#define FRAME_CHANGE_THRESHOLD 12
+#define DUTY_CYCLE_POLL_MS 20
+#define DUTY_CYCLE_IDLE_TIMEOUT_MS 200 /* a frame in progress plus FRAME_POOL_STALL_MS */
+
+typedef struct {
+  unsigned int lightSleeps;
+  unsigned int rejectedSleeps;
+  int64_t sleptMs;
+  int64_t enabledMs;
+  int64_t lastWakeToFirstDecodeMs;
+  int64_t worstWakeToFirstDecodeMs;
+} LowPowerStats;
+
+void setupLowPowerCapture(DutyCycleConfig config);
+void enableLowPowerCapture();
+void disableLowPowerCapture();
+
+bool checkFrameChange(camera_fb_t *frame);
+void reportCaptureActivity(bool frameChanged, bool decoded, int64_t capturedAtMs);
+
+LowPowerStats getLowPowerStats();
+void printLowPowerStats();
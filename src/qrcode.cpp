@@ -1,27 +1,65 @@
 #include <qrcode.h>
 #include <stdint.h>
+#include <boot.h>
+#include <power.h>
 
-ESP32QRCodeReader reader(CAMERA_MODEL_AI_THINKER);
+extern "C" {
+#include <quirc/quirc_internal.h>
+}
+
+#define QR_CODE_PAYLOAD_MAX_LENGTH 1024
+/* quirc_end() flood fills the regions recursively, so the detection needs the
+ * same stack as the library detect task (QR_CODE_READER_STACK_SIZE) */
+#define QR_CODE_TASK_STACK_SIZE (40 * 1024)
+/* esp_camera_init() probes the sensor over SCCB and logs, it usually runs on the 8 KB loopTask */
+#define CAMERA_INIT_TASK_STACK_SIZE (8 * 1024)
 
 void onQrCodeTask(void *pvParameters);
+void cameraInitTask(void *pvParameters);
+bool detectQRCode(camera_fb_t *frame);
 
+/* kept out of the task stack, quirc_code and quirc_data take ~13 KB */
+struct quirc *qr = NULL;
+struct quirc_code qrCode;
+struct quirc_data qrData;
+uint8_t qrCodePayloadBuffer[QR_CODE_PAYLOAD_MAX_LENGTH];
+
+TaskHandle_t qrCodeTaskHandle = NULL;
+int cameraInitStackFree = -1;
 int readingDelay = 50;
 bool readingQRCode = false;
 
 QRCodePayload qrCodePayload = {
   NULL,
   -1,
-  false
+  false,
+  -1
 };
 
 /**
- * @brief Setups the QR Code reader
+ * @brief Setups the QR Code reader. The camera sensor is initialized in the background,
+ * so the caller can prepare the rest of the system meanwhile
  */
 void setupQRCodeReader() {
-  reader.setup();
-  reader.beginOnCore(1);
-  xTaskCreate(onQrCodeTask, "onQrCode", 4 * 1024, NULL, 4, NULL);
+  xTaskCreatePinnedToCore(cameraInitTask, "cameraInit", CAMERA_INIT_TASK_STACK_SIZE, NULL, 5, NULL, FRAME_POOL_CAPTURE_CORE);
+  qr = quirc_new();
+  xTaskCreatePinnedToCore(onQrCodeTask, "onQrCode", QR_CODE_TASK_STACK_SIZE, NULL, 4, &qrCodeTaskHandle, 1);
   resumeQRCodeReading();
+  markBootPhase("qrCodeReaderSetup");
+}
+
+/**
+ * @brief The camera sensor initialization task from the RTOS, runs once
+ */
+void cameraInitTask(void *pvParameters) {
+  if(setupFramePool()) {
+    markBootPhase("cameraReady");
+  } else {
+    markBootPhase("cameraFailed");
+  }
+  /* the task deletes itself, so its high-water mark is kept for printQRCodeReaderStackUsage() */
+  cameraInitStackFree = uxTaskGetStackHighWaterMark(NULL);
+  vTaskDelete(NULL);
 }
 
 /**
@@ -29,6 +67,7 @@ void setupQRCodeReader() {
  */
 void resumeQRCodeReading() {
   readingQRCode = true;
+  resumeFramePool();
 }
 
 /**
@@ -36,6 +75,15 @@ void resumeQRCodeReading() {
  */
 void suspendQRCodeReading() {
   readingQRCode = false;
+  pauseFramePool();
+}
+
+/**
+ * @brief Checks if the QR Code reading is active
+ * @return True if reading and false if suspended
+ */
+bool isQRCodeReading() {
+  return readingQRCode;
 }
 
 /**
@@ -50,17 +98,19 @@ void setReadingDelay(int newDelay) {
  * @brief The QR Code reading task from the RTOS
  */
 void onQrCodeTask(void *pvParameters) {
-  struct QRCodeData qrCodeData;
+  camera_fb_t *frame;
   while (true) {
     if (readingQRCode) {
-      if (reader.receiveQrCode(&qrCodeData, 100)) {
-        if (qrCodeData.valid) {
-          qrCodePayload.rawPayload = qrCodeData.payload;
-          qrCodePayload.payloadLength = qrCodeData.payloadLen;
-          qrCodePayload.successfulRead = true;
-        } else {
-          qrCodePayload.successfulRead = false;
-        }
+      frame = acquireFrame(100);
+      if (frame != NULL) {
+        markScanReady();
+        bool frameChanged = checkFrameChange(frame);
+        /* the camera driver stamps the frames with esp_timer_get_time() */
+        int64_t capturedAt = frame->timestamp.tv_sec * 1000000LL + frame->timestamp.tv_usec;
+        qrCodePayload.capturedAt = capturedAt;
+        qrCodePayload.successfulRead = detectQRCode(frame);
+        releaseFrame(frame);
+        reportCaptureActivity(frameChanged, qrCodePayload.successfulRead, capturedAt / 1000);
       } else {
         qrCodePayload.successfulRead = false;
       }
@@ -69,6 +119,74 @@ void onQrCodeTask(void *pvParameters) {
   }
 }
 
+/**
+ * @brief Detects and decodes a QR Code directly from the grayscale frame buffer, without copying the frame
+ * @param frame The frame buffer lent by the frame pool
+ * @return True if a QR Code was decoded and false otherwise
+ */
+bool detectQRCode(camera_fb_t *frame) {
+  bool decoded = false;
+  if (qr == NULL || frame->len != frame->width * frame->height) return false;
+  if (qr->w != (int) frame->width || qr->h != (int) frame->height) {
+    if (quirc_resize(qr, frame->width, frame->height) < 0) return false;
+    /* quirc_resize allocates a w*h image buffer (~77 KB for QVGA) that is never used, because
+     * the detection reads the frame buffer. quirc_resize and quirc_destroy free NULL safely */
+    free(qr->image);
+    qr->image = NULL;
+    if (sizeof(*qr->image) == sizeof(*qr->pixels)) qr->pixels = NULL;
+  }
+
+  /* points quirc to the frame buffer, instead of an image buffer of its own that would need a memcpy.
+   * quirc thresholds the image in place, so the frame must not be reused after detection */
+  uint8_t *qrImage = quirc_begin(qr, NULL, NULL);
+  quirc_pixel_t *qrPixels = qr->pixels;
+  qr->image = frame->buf;
+  if (sizeof(*qr->image) == sizeof(*qr->pixels)) qr->pixels = (quirc_pixel_t *) frame->buf;
+
+  quirc_end(qr);
+  int count = quirc_count(qr);
+  for (int i = 0; i < count && !decoded; i++) {
+    quirc_extract(qr, i, &qrCode);
+    if (quirc_decode(&qrCode, &qrData) == QUIRC_SUCCESS && qrData.payload_len <= QR_CODE_PAYLOAD_MAX_LENGTH) {
+      memcpy(qrCodePayloadBuffer, qrData.payload, qrData.payload_len);
+      qrCodePayload.rawPayload = qrCodePayloadBuffer;
+      qrCodePayload.payloadLength = qrData.payload_len;
+      decoded = true;
+    }
+  }
+
+  /* gives quirc its own buffers back (no image, and the pixels only if not aliased), so
+   * quirc_resize and quirc_destroy never free the frame buffer */
+  qr->image = qrImage;
+  qr->pixels = qrPixels;
+  return decoded;
+}
+
+/**
+ * @brief Prints the minimum free stack (high-water mark) of the camera init task and of the
+ * QR Code reading task, in bytes, to check the stack sizes on the hardware after some QR Codes
+ * were decoded
+ */
+void printQRCodeReaderStackUsage() {
+  Serial.print("cameraInitStackFree: ");
+  if(cameraInitStackFree >= 0) {
+    Serial.print(cameraInitStackFree);
+    Serial.print("/");
+    Serial.println(CAMERA_INIT_TASK_STACK_SIZE);
+  } else {
+    Serial.println("NULL");
+  }
+
+  Serial.print("onQrCodeStackFree: ");
+  if(qrCodeTaskHandle != NULL) {
+    Serial.print(uxTaskGetStackHighWaterMark(qrCodeTaskHandle));
+    Serial.print("/");
+    Serial.println(QR_CODE_TASK_STACK_SIZE);
+  } else {
+    Serial.println("NULL");
+  }
+}
+
 /**
  * @brief Reads the QR Code from the ESP32-CAM
  * @return The read QR Code payload
@@ -1,16 +1,19 @@
-#include <ESP32QRCodeReader.h>
+#include <framepool.h>
 #include <stdint.h>
 
 typedef struct {
   uint8_t *rawPayload;
   int payloadLength;
   bool successfulRead;
+  int64_t capturedAt; /* capture time of the decoded frame, in microseconds since the boot */
 } QRCodePayload;
 
 void setupQRCodeReader();
 void resumeQRCodeReading();
 void suspendQRCodeReading();
+bool isQRCodeReading();
 void setReadingDelay(int newDelay);
 
 QRCodePayload readQRCode();
-void printQRCodePayload(QRCodePayload qrcode, int format);
\ No newline at end of file
+void printQRCodePayload(QRCodePayload qrcode, int format);
+void printQRCodeReaderStackUsage();
\ No newline at end of file
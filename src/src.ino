@@ -3,23 +3,38 @@
 #include <decoder.h>
 #include <stdint.h>
 #include <auth.h>
+#include <boot.h>
+#include <power.h>
 
 #include "esp_heap_caps.h"
 
 #define BAUD_RATE 115200
 #define ELETRIC_LOCK_PINK 2
 #define LED_BUILTIN 4
+#define LOW_POWER_CAPTURE false
 
 void ledBlink(int n);
 void printHeapFreeSize();
 void unlock();
 
 void setup() {
-  Serial.begin(BAUD_RATE);
+  markBootPhase("setup");
+  /* the camera sensor initializes in the background while the rest is prepared */
+  setupQRCodeReader();
   pinMode(LED_BUILTIN, OUTPUT);
   pinMode(ELETRIC_LOCK_PINK, OUTPUT);
-  setupQRCodeReader();
-  resumeQRCodeReading();
+  setupAuth();
+  markBootPhase("authReady");
+  if(LOW_POWER_CAPTURE) {
+    DutyCycleConfig dutyCycleConfig = {
+      DEFAULT_DUTY_CYCLE_SLEEP_MS, /* int sleepMs */
+      DEFAULT_DUTY_CYCLE_PROBE_MS, /* int probeMs */
+      DEFAULT_DUTY_CYCLE_BURST_MS, /* int burstMs */
+    };
+    setupLowPowerCapture(dutyCycleConfig);
+  }
+  Serial.begin(BAUD_RATE);
+  markBootPhase("serialReady");
 }
 
 void loop() {
@@ -30,14 +45,22 @@ void loop() {
       decodedQRCodeData.payloadMessage,
       decodedQRCodeData.payloadHash,
       decodedQRCodeData.messageLength,
+      decodedQRCodeData.hashLength,
       decodedQRCodeData.messageType
     );
+    /* stamped as soon as the scan is verified, the prints and the blink are not part of the metric */
+    bool firstVerifiedScan = validity && markFirstVerifiedScan(qrcodePayload.capturedAt);
     printDecodedQRCodeData(decodedQRCodeData);
     Serial.print("validity: ");
     Serial.println(validity);
     ledBlink(1, 50);
     if(validity) {
       unlock();
+      /* printed after the unlock, so the report does not delay the first access */
+      if(firstVerifiedScan) {
+        printBootReport();
+        printQRCodeReaderStackUsage();
+      }
     }
     freeMallocData(&decodedQRCodeData);
   }
@@ -0,0 +1,92 @@
+/*
+ * Host replay of the boot reports printed by printBootReport() (src/boot.cpp).
+ *
+ * Build: g++ boot_replay.cpp -o boot_replay
+ * Usage: ./boot_replay [maxMs] < report.txt
+ *
+ * Reads the report captured from the serial monitor and prints the time of each
+ * markBootPhase() timestamp and the time spent since the previous one, followed by
+ * the boot-to-scan-ready and boot-to-first-verified-scan times of that boot. With
+ * maxMs, exits with 2 if boot-to-scan-ready (or boot-to-first-verified-scan, when the
+ * boot recorded it) exceeds maxMs, for regression checks against recorded boots.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PHASES 32
+
+bool exceeds(long long timestamp, long maxMs) {
+  return maxMs >= 0 && timestamp > maxMs * 1000LL;
+}
+
+void printMetric(const char *name, long long timestamp) {
+  if(timestamp >= 0) {
+    printf("%s: %.3f\n", name, timestamp / 1000.0);
+  } else {
+    printf("%s: NULL\n", name);
+  }
+}
+
+int replayBootReport(FILE *file, long maxMs) {
+  char line[128];
+  char names[MAX_PHASES][64];
+  long long timestamps[MAX_PHASES];
+  int count = 0;
+  long long scanReady = -1;
+  long long firstVerifiedScan = -1;
+  bool inPhases = false;
+
+  while(fgets(line, sizeof(line), file) != NULL) {
+    if(strncmp(line, "boot phases", 11) == 0) {
+      inPhases = true;
+      continue;
+    }
+    /* phase lines are indented, the metric lines after them are not */
+    if(inPhases && strncmp(line, "  ", 2) == 0 && count < MAX_PHASES && sscanf(line, "  %63[^:]: %lld", names[count], &timestamps[count]) == 2) {
+      if(strcmp(names[count], "scanReady") == 0) scanReady = timestamps[count];
+      if(strcmp(names[count], "firstVerifiedScan") == 0) firstVerifiedScan = timestamps[count];
+      count++;
+      continue;
+    }
+    inPhases = false;
+  }
+  if(count == 0) {
+    fprintf(stderr, "no boot phases found\n");
+    return 1;
+  }
+
+  printf("phase: atMs (sincePreviousMs)\n");
+  for(int i = 0; i < count; i++) {
+    long long previous = i > 0 ? timestamps[i - 1] : 0;
+    printf("  %s: %.3f (%.3f)\n", names[i], timestamps[i] / 1000.0, (timestamps[i] - previous) / 1000.0);
+  }
+  printMetric("bootToScanReadyMs", scanReady);
+  printMetric("bootToFirstVerifiedScanMs", firstVerifiedScan);
+
+  if(maxMs >= 0 && (scanReady < 0 || exceeds(scanReady, maxMs))) {
+    fprintf(stderr, "bootToScanReady above %ld ms\n", maxMs);
+    return 2;
+  }
+  if(exceeds(firstVerifiedScan, maxMs)) {
+    fprintf(stderr, "bootToFirstVerifiedScan above %ld ms\n", maxMs);
+    return 2;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  long maxMs = -1;
+  if(argc == 2) {
+    char *end;
+    maxMs = strtol(argv[1], &end, 10);
+    if(*end != '\0' || maxMs <= 0) {
+      fprintf(stderr, "invalid maxMs: %s\n", argv[1]);
+      return 1;
+    }
+  } else if(argc != 1) {
+    fprintf(stderr, "usage: %s [maxMs] < report.txt\n", argv[0]);
+    return 1;
+  }
+  return replayBootReport(stdin, maxMs);
+}
@@ -0,0 +1,103 @@
+/*
+ * Host simulation of the duty-cycled capture policy (src/dutycycle.cpp).
+ *
+ * Build: g++ -I../src dutycycle_sim.cpp ../src/dutycycle.cpp -o dutycycle_sim
+ * Usage: ./dutycycle_sim [sleepMs probeMs burstMs frameMs wakeMs] < trace.txt
+ *
+ * The trace has one arrival per line, "arrivalMs holdMs", where holdMs is how long
+ * the user keeps the QR Code in front of the camera. Lines starting with # are ignored.
+ * The same trace is simulated with the camera always on, to compute the added latency.
+ */
+#include <dutycycle.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_ARRIVALS 4096
+#define TRACE_TAIL_MS 10000
+
+DutyCycleArrival arrivals[MAX_ARRIVALS];
+int64_t dutyCycleDecodedAt[MAX_ARRIVALS];
+int64_t alwaysOnDecodedAt[MAX_ARRIVALS];
+
+int readTrace(FILE *file) {
+  char line[128];
+  long long arrivalMs, holdMs;
+  int count = 0;
+  while(count < MAX_ARRIVALS && fgets(line, sizeof(line), file) != NULL) {
+    if(line[0] == '#') continue;
+    if(sscanf(line, "%lld %lld", &arrivalMs, &holdMs) != 2) continue;
+    arrivals[count].arrivalMs = arrivalMs;
+    arrivals[count].holdMs = holdMs;
+    count++;
+  }
+  return count;
+}
+
+void printUsage(const char *program) {
+  fprintf(stderr, "usage: %s [sleepMs probeMs burstMs frameMs wakeMs] < trace.txt\n", program);
+  fprintf(stderr, "       sleepMs, probeMs, burstMs and frameMs must be positive, wakeMs non-negative\n");
+}
+
+int main(int argc, char **argv) {
+  DutyCycleConfig config = {
+    DEFAULT_DUTY_CYCLE_SLEEP_MS, /* int sleepMs */
+    DEFAULT_DUTY_CYCLE_PROBE_MS, /* int probeMs */
+    DEFAULT_DUTY_CYCLE_BURST_MS, /* int burstMs */
+  };
+  DutyCycleSimulation simulation = {
+    100, /* int frameMs */
+    30,  /* int wakeMs  */
+  };
+  if(argc == 6) {
+    int *fields[] = {&config.sleepMs, &config.probeMs, &config.burstMs, &simulation.frameMs, &simulation.wakeMs};
+    for(int i = 0; i < 5; i++) {
+      char *end;
+      long value = strtol(argv[i + 1], &end, 10);
+      /* every timing must advance the simulated time, except the wake overhead */
+      if(*end != '\0' || value < 0 || (value == 0 && i != 4)) {
+        fprintf(stderr, "invalid timing: %s\n", argv[i + 1]);
+        printUsage(argv[0]);
+        return 1;
+      }
+      *fields[i] = (int) value;
+    }
+  } else if(argc != 1) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  int arrivalsCount = readTrace(stdin);
+  int64_t durationMs = TRACE_TAIL_MS;
+  for(int i = 0; i < arrivalsCount; i++) {
+    if(arrivals[i].arrivalMs + arrivals[i].holdMs + TRACE_TAIL_MS > durationMs)
+      durationMs = arrivals[i].arrivalMs + arrivals[i].holdMs + TRACE_TAIL_MS;
+  }
+
+  DutyCycleConfig alwaysOnConfig = config;
+  alwaysOnConfig.sleepMs = 0;
+  DutyCycleReport report = simulateDutyCycle(config, simulation, arrivals, arrivalsCount, durationMs, dutyCycleDecodedAt);
+  simulateDutyCycle(alwaysOnConfig, simulation, arrivals, arrivalsCount, durationMs, alwaysOnDecodedAt);
+
+  int64_t worstAddedLatencyMs = 0;
+  int64_t totalAddedLatencyMs = 0;
+  for(int i = 0; i < arrivalsCount; i++) {
+    if(dutyCycleDecodedAt[i] < 0 || alwaysOnDecodedAt[i] < 0) continue;
+    int64_t addedLatencyMs = dutyCycleDecodedAt[i] - alwaysOnDecodedAt[i];
+    totalAddedLatencyMs += addedLatencyMs;
+    if(addedLatencyMs > worstAddedLatencyMs) worstAddedLatencyMs = addedLatencyMs;
+  }
+
+  printf("arrivals: %d\n", arrivalsCount);
+  printf("decodedArrivals: %d\n", report.decodedArrivals);
+  printf("missedArrivals: %d\n", report.missedArrivals);
+  printf("averageDuty: %.3f\n", report.averageDuty);
+  printf("worstAddedLatencyMs: %lld\n", (long long) worstAddedLatencyMs);
+  if(report.decodedArrivals > 0)
+    printf("meanAddedLatencyMs: %lld\n", (long long) (totalAddedLatencyMs / report.decodedArrivals));
+  if(report.worstWakeToFirstDecodeMs >= 0) {
+    printf("worstWakeToFirstDecodeMs: %lld\n", (long long) report.worstWakeToFirstDecodeMs);
+  } else {
+    printf("worstWakeToFirstDecodeMs: NULL\n");
+  }
+  return 0;
+}
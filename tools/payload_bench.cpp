@@ -0,0 +1,314 @@
+/*
+ * Host benchmark of the v1 and v2 ACCESS payload encodings, through the firmware
+ * decoder (src/decoder.cpp) and the quirc detector the firmware runs.
+ *
+ * Build, with the quirc sources shipped in the ESP32QRCodeReader library:
+ *   QUIRC=~/Arduino/libraries/ESP32QRCodeReader/src
+ *   gcc -O2 -c $QUIRC/quirc/quirc.c $QUIRC/quirc/decode.c $QUIRC/quirc/identify.c $QUIRC/quirc/version_db.c
+ *   g++ -O2 -I../src -I$QUIRC payload_bench.cpp qrencode.cpp ../src/decoder.cpp *.o -o payload_bench
+ * Usage: ./payload_bench [qrCodePixels] [userId ...]
+ *
+ * First checks the decoder: every payload is encoded and decoded back with
+ * getQRCodeData(), and truncated, over-long and unterminated payloads must be rejected.
+ * The bench exits with 1 if a check fails.
+ *
+ * Then, for each userId and ECC level, renders the payload in the smallest QR Code
+ * version (byte mode) into a grayscale QVGA frame, with the QR Code (and its 4-module
+ * quiet zone) spanning qrCodePixels pixels (120 by default, about a third of the frame
+ * width), and times quirc_end() and quirc_extract() + quirc_decode() on it, as
+ * detectQRCode() runs them. The decoded payload goes through getQRCodeData() again.
+ */
+#include <decoder.h>
+#include "qrencode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+#include <quirc/quirc.h>
+}
+
+#define MAX_PAYLOAD_LENGTH 64
+#define QR_QUIET_ZONE 4
+#define QR_BENCH_MASK 0
+#define BENCH_ITERATIONS 20
+
+/* FRAMESIZE_QVGA, src/framepool.h */
+#define FRAME_WIDTH 320
+#define FRAME_HEIGHT 240
+#define FRAME_LIGHT 220
+#define FRAME_DARK 30
+
+const char QR_ECC_LEVELS[4] = {'L', 'M', 'Q', 'H'};
+const unsigned int GENERATED_AT = 1760000000; /* 2025-10-09 */
+
+uint8_t frame[FRAME_WIDTH * FRAME_HEIGHT];
+QREncodedCode qrEncodedCode;
+struct quirc_code qrCode;
+struct quirc_data qrData;
+int failedChecks = 0;
+
+int encodeAccessV1(unsigned int userId, unsigned int generatedAt, uint8_t *payload) {
+  int length = 0;
+  payload[length++] = MESSAGE_TYPE_ACCESS << 4 | OPERATION_TYPE_CHECK_IN;
+  for(int i = USER_ID_LENGTH - 1; i >= 0; i--)
+    payload[length++] = (userId >> 8 * i) & 0xFF;
+  for(int i = DATETIME_LENGTH - 1; i >= 0; i--)
+    payload[length++] = (generatedAt >> 8 * i) & 0xFF;
+  /* any hash bytes, only their length and position matter to the decoder */
+  for(int i = 0; i < HASH_LENGTH; i++)
+    payload[length++] = 0xA0 + i;
+  return length;
+}
+
+int encodeAccessV2(unsigned int userId, unsigned int generatedAt, uint8_t *payload) {
+  int length = 0;
+  unsigned int delta = (generatedAt - V2_DATETIME_EPOCH) / V2_DATETIME_RESOLUTION;
+  payload[length++] = PAYLOAD_VERSION_2_FLAG | MESSAGE_TYPE_ACCESS << 4 | OPERATION_TYPE_CHECK_IN;
+  do {
+    uint8_t group = userId & 0x7F;
+    userId >>= 7;
+    payload[length++] = userId ? group | 0x80 : group;
+  } while(userId);
+  for(int i = V2_DATETIME_LENGTH - 1; i >= 0; i--)
+    payload[length++] = (delta >> 8 * i) & 0xFF;
+  for(int i = 0; i < V2_HASH_LENGTH; i++)
+    payload[length++] = 0xA0 + i;
+  return length;
+}
+
+void check(bool condition, const char *name, unsigned int userId) {
+  if(condition) return;
+  fprintf(stderr, "check failed: %s (userId %u)\n", name, userId);
+  failedChecks++;
+}
+
+/**
+ * @brief Decodes the payload with the firmware decoder and checks every ACCESS field
+ */
+void checkDecoding(uint8_t *payload, int payloadLength, int payloadVersion, unsigned int userId) {
+  int hashLength = payloadVersion == 2 ? V2_HASH_LENGTH : HASH_LENGTH;
+  /* v2 keeps the minute of generatedAt */
+  unsigned int generatedAt = payloadVersion == 2 ? GENERATED_AT - (GENERATED_AT - V2_DATETIME_EPOCH) % V2_DATETIME_RESOLUTION : GENERATED_AT;
+  DecodedQRCodeData decoded = getQRCodeData(payload, payloadLength);
+  check(decoded.successfulDecoding, "successfulDecoding", userId);
+  if(decoded.successfulDecoding) {
+    check(decoded.payloadVersion == payloadVersion, "payloadVersion", userId);
+    check(decoded.messageType == MESSAGE_TYPE_ACCESS, "messageType", userId);
+    check(decoded.userId == userId, "userId", userId);
+    check(decoded.generatedAt == generatedAt, "generatedAt", userId);
+    check(decoded.hashLength == hashLength, "hashLength", userId);
+    check(decoded.messageLength == payloadLength - hashLength, "messageLength", userId);
+    check(memcmp(decoded.payloadMessage, payload, payloadLength - hashLength) == 0, "payloadMessage", userId);
+    check(memcmp(decoded.payloadHash, payload + payloadLength - hashLength, hashLength) == 0, "payloadHash", userId);
+    check(decoded.needToAuthenticate, "needToAuthenticate", userId);
+  }
+  freeMallocData(&decoded);
+}
+
+void checkRejected(uint8_t *payload, int payloadLength, const char *name, unsigned int userId) {
+  DecodedQRCodeData decoded = getQRCodeData(payload, payloadLength);
+  check(!decoded.successfulDecoding, name, userId);
+  freeMallocData(&decoded);
+}
+
+/**
+ * @brief Round trips the payload and checks that every truncation and an extra byte are rejected
+ */
+void checkPayload(uint8_t *payload, int payloadLength, int payloadVersion, unsigned int userId) {
+  uint8_t altered[MAX_PAYLOAD_LENGTH + 1];
+  checkDecoding(payload, payloadLength, payloadVersion, userId);
+  for(int length = 0; length < payloadLength; length++) {
+    /* copied, so a read past the truncated length is caught by the sanitizers */
+    uint8_t *truncated = (uint8_t *) malloc(length > 0 ? length : 1);
+    memcpy(truncated, payload, length);
+    checkRejected(truncated, length, "truncated payload rejected", userId);
+    free(truncated);
+  }
+  memcpy(altered, payload, payloadLength);
+  altered[payloadLength] = 0;
+  checkRejected(altered, payloadLength + 1, "over-long payload rejected", userId);
+}
+
+/**
+ * @brief Checks that malformed v2 userId varints are rejected
+ */
+void checkVarints() {
+  uint8_t header = PAYLOAD_VERSION_2_FLAG | MESSAGE_TYPE_ACCESS << 4;
+  uint8_t payload[MAX_PAYLOAD_LENGTH];
+  int length;
+
+  /* 6-byte varint, longer than VARINT_MAX_LENGTH */
+  length = 0;
+  payload[length++] = header;
+  for(int i = 0; i < VARINT_MAX_LENGTH; i++) payload[length++] = 0x80;
+  payload[length++] = 0x01;
+  memset(payload + length, 0, V2_DATETIME_LENGTH + V2_HASH_LENGTH);
+  checkRejected(payload, length + V2_DATETIME_LENGTH + V2_HASH_LENGTH, "6-byte varint rejected", 0);
+
+  /* 5-byte varint with more than 32 bits */
+  length = 0;
+  payload[length++] = header;
+  for(int i = 0; i < VARINT_MAX_LENGTH - 1; i++) payload[length++] = 0xFF;
+  payload[length++] = 0x10;
+  memset(payload + length, 0, V2_DATETIME_LENGTH + V2_HASH_LENGTH);
+  checkRejected(payload, length + V2_DATETIME_LENGTH + V2_HASH_LENGTH, "33-bit varint rejected", 0);
+
+  /* varint not terminated before the end of the payload */
+  for(length = HEADER_LENGTH + 1; length <= HEADER_LENGTH + VARINT_MAX_LENGTH; length++) {
+    payload[0] = header;
+    memset(payload + HEADER_LENGTH, 0x80, length - HEADER_LENGTH);
+    checkRejected(payload, length, "unterminated varint rejected", 0);
+  }
+
+  /* a v2 encoding of a message type other than ACCESS */
+  length = encodeAccessV2(1, GENERATED_AT, payload);
+  payload[0] = PAYLOAD_VERSION_2_FLAG | MESSAGE_TYPE_SYNC << 4;
+  checkRejected(payload, length, "v2 SYNC rejected", 1);
+}
+
+int getMinimumQRVersion(int payloadLength, int eccLevel) {
+  for(int version = 1; version <= QR_ENCODE_MAX_VERSION; version++) {
+    if(getQRByteCapacity(version, eccLevel) >= payloadLength) return version;
+  }
+  return -1;
+}
+
+/**
+ * @brief Renders the QR Code centered in the frame, nearest neighbor scaled to qrCodePixels
+ */
+void renderFrame(QREncodedCode *code, int qrCodePixels) {
+  int modules = code->size + 2 * QR_QUIET_ZONE;
+  int left = (FRAME_WIDTH - qrCodePixels) / 2;
+  int top = (FRAME_HEIGHT - qrCodePixels) / 2;
+  memset(frame, FRAME_LIGHT, sizeof(frame));
+  for(int y = 0; y < qrCodePixels; y++) {
+    int row = y * modules / qrCodePixels - QR_QUIET_ZONE;
+    if(row < 0 || row >= code->size || top + y < 0 || top + y >= FRAME_HEIGHT) continue;
+    for(int x = 0; x < qrCodePixels; x++) {
+      int column = x * modules / qrCodePixels - QR_QUIET_ZONE;
+      if(column < 0 || column >= code->size || left + x < 0 || left + x >= FRAME_WIDTH) continue;
+      if(code->modules[row][column]) frame[(top + y) * FRAME_WIDTH + left + x] = FRAME_DARK;
+    }
+  }
+}
+
+double getTimeUs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Times the detection and decoding of the rendered frame, as detectQRCode() runs them
+ * @return True if the payload was decoded back and false otherwise
+ */
+bool benchFrame(struct quirc *qr, uint8_t *payload, int payloadLength, int payloadVersion, unsigned int userId, double *endUs, double *decodeUs) {
+  bool decoded = false;
+  *endUs = 0;
+  *decodeUs = 0;
+  for(int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+    /* quirc thresholds the image in place, the frame is copied in for each iteration */
+    uint8_t *image = quirc_begin(qr, NULL, NULL);
+    memcpy(image, frame, sizeof(frame));
+
+    double start = getTimeUs();
+    quirc_end(qr);
+    double detected = getTimeUs();
+    int count = quirc_count(qr);
+    bool iterationDecoded = false;
+    for(int i = 0; i < count && !iterationDecoded; i++) {
+      quirc_extract(qr, i, &qrCode);
+      iterationDecoded = quirc_decode(&qrCode, &qrData) == QUIRC_SUCCESS;
+    }
+    double end = getTimeUs();
+    *endUs += detected - start;
+    *decodeUs += end - detected;
+    decoded = iterationDecoded;
+  }
+  *endUs /= BENCH_ITERATIONS;
+  *decodeUs /= BENCH_ITERATIONS;
+
+  if(decoded) {
+    check(qrData.payload_len == payloadLength && memcmp(qrData.payload, payload, payloadLength) == 0, "quirc payload", userId);
+    checkDecoding(qrData.payload, qrData.payload_len, payloadVersion, userId);
+  }
+  return decoded;
+}
+
+void benchEncoding(struct quirc *qr, const char *name, uint8_t *payload, int payloadLength, int payloadVersion, unsigned int userId, int qrCodePixels) {
+  double endUs, decodeUs;
+  printf("  %s: %d bytes\n", name, payloadLength);
+  for(int ecc = 0; ecc < 4; ecc++) {
+    int version = getMinimumQRVersion(payloadLength, ecc);
+    int modules = 17 + 4 * version;
+    double pixelsPerModule = (double) qrCodePixels / (modules + 2 * QR_QUIET_ZONE);
+    printf("    %c: v%d (%d modules, %.2f px/module)", QR_ECC_LEVELS[ecc], version, modules, pixelsPerModule);
+    encodeQRCode(payload, payloadLength, version, ecc, QR_BENCH_MASK, &qrEncodedCode);
+    renderFrame(&qrEncodedCode, qrCodePixels);
+    bool decoded = benchFrame(qr, payload, payloadLength, payloadVersion, userId, &endUs, &decodeUs);
+    printf(", quirc_end %.0f us, quirc_decode %.0f us%s\n", endUs, decodeUs, decoded ? "" : ", not decoded");
+  }
+}
+
+int main(int argc, char **argv) {
+  unsigned int defaultUserIds[] = {1, 127, 128, 16383, 16384, 2097152, 4294967295u};
+  int qrCodePixels = 120;
+  int firstUserId = 1;
+  unsigned int userIds[256];
+  uint8_t payload[MAX_PAYLOAD_LENGTH];
+  int length;
+
+  if(argc > 1) {
+    char *end;
+    long value = strtol(argv[1], &end, 10);
+    if(*end != '\0' || value <= 0 || value > FRAME_HEIGHT) {
+      fprintf(stderr, "usage: %s [qrCodePixels] [userId ...]\n", argv[0]);
+      fprintf(stderr, "       qrCodePixels between 1 and %d\n", FRAME_HEIGHT);
+      return 1;
+    }
+    qrCodePixels = (int) value;
+    firstUserId = 2;
+  }
+
+  int userIdsCount = argc > firstUserId ? argc - firstUserId : (int) (sizeof(defaultUserIds) / sizeof(defaultUserIds[0]));
+  if(userIdsCount > 256) userIdsCount = 256;
+  for(int i = 0; i < userIdsCount; i++) {
+    if(argc <= firstUserId) {
+      userIds[i] = defaultUserIds[i];
+      continue;
+    }
+    char *end;
+    unsigned long value = strtoul(argv[firstUserId + i], &end, 10);
+    if(*end != '\0' || value > 4294967295ul) {
+      fprintf(stderr, "invalid userId: %s\n", argv[firstUserId + i]);
+      return 1;
+    }
+    userIds[i] = (unsigned int) value;
+  }
+
+  for(int i = 0; i < userIdsCount; i++) {
+    length = encodeAccessV1(userIds[i], GENERATED_AT, payload);
+    checkPayload(payload, length, 1, userIds[i]);
+    length = encodeAccessV2(userIds[i], GENERATED_AT, payload);
+    checkPayload(payload, length, 2, userIds[i]);
+  }
+  checkVarints();
+  printf("decoder checks: %s\n", failedChecks == 0 ? "ok" : "FAILED");
+
+  struct quirc *qr = quirc_new();
+  if(qr == NULL || quirc_resize(qr, FRAME_WIDTH, FRAME_HEIGHT) < 0) {
+    fprintf(stderr, "quirc allocation failed\n");
+    return 1;
+  }
+  for(int i = 0; i < userIdsCount; i++) {
+    printf("userId %u:\n", userIds[i]);
+    length = encodeAccessV1(userIds[i], GENERATED_AT, payload);
+    benchEncoding(qr, "v1", payload, length, 1, userIds[i], qrCodePixels);
+    length = encodeAccessV2(userIds[i], GENERATED_AT, payload);
+    benchEncoding(qr, "v2", payload, length, 2, userIds[i], qrCodePixels);
+  }
+  quirc_destroy(qr);
+  return failedChecks == 0 ? 0 : 1;
+}
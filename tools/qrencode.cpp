@@ -0,0 +1,281 @@
+#include "qrencode.h"
+#include <string.h>
+
+/*
+ * Minimal QR Code encoder (ISO/IEC 18004), byte mode only and versions 1 to
+ * QR_ENCODE_MAX_VERSION, to render the payloads for the host benchmark.
+ * The mask is chosen by the caller, the decoder does not depend on it.
+ */
+
+#define QR_MAX_CODEWORDS 512
+#define QR_MAX_BLOCKS 8
+#define QR_MAX_BLOCK_CODEWORDS 160
+
+/* per ECC level (L, M, Q, H) and version (index 0 unused) */
+const int QR_ECC_CODEWORDS_PER_BLOCK[4][QR_ENCODE_MAX_VERSION + 1] = {
+  {-1, 7, 10, 15, 20, 26, 18, 20, 24, 30, 18},
+  {-1, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26},
+  {-1, 13, 22, 18, 26, 18, 24, 18, 22, 20, 24},
+  {-1, 17, 28, 22, 16, 22, 28, 26, 26, 24, 28},
+};
+const int QR_ECC_BLOCKS[4][QR_ENCODE_MAX_VERSION + 1] = {
+  {-1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 4},
+  {-1, 1, 1, 1, 2, 2, 4, 4, 4, 5, 5},
+  {-1, 1, 1, 2, 2, 4, 4, 6, 6, 8, 8},
+  {-1, 1, 1, 2, 4, 4, 4, 5, 6, 8, 8},
+};
+/* format information ECC level bits */
+const int QR_ECC_FORMAT_BITS[4] = {1, 0, 3, 2};
+
+bool functionModules[QR_ENCODE_MAX_SIZE][QR_ENCODE_MAX_SIZE];
+
+/**
+ * @brief Counts the modules available for data and ECC codewords in a version
+ */
+int getRawDataModules(int version) {
+  int modules = (16 * version + 128) * version + 64;
+  if(version >= 2) {
+    int alignments = version / 7 + 2;
+    modules -= (25 * alignments - 10) * alignments - 55;
+    if(version >= 7) modules -= 36;
+  }
+  return modules;
+}
+
+int getDataCodewords(int version, int eccLevel) {
+  return getRawDataModules(version) / 8 - QR_ECC_CODEWORDS_PER_BLOCK[eccLevel][version] * QR_ECC_BLOCKS[eccLevel][version];
+}
+
+int getCountBits(int version) {
+  return version <= 9 ? 8 : 16;
+}
+
+/**
+ * @brief Gets the byte mode capacity of a version and ECC level
+ * @return The capacity in bytes, or -1 if the version is not supported
+ */
+int getQRByteCapacity(int version, int eccLevel) {
+  if(version < 1 || version > QR_ENCODE_MAX_VERSION || eccLevel < 0 || eccLevel > 3) return -1;
+  return (getDataCodewords(version, eccLevel) * 8 - 4 - getCountBits(version)) / 8;
+}
+
+uint8_t multiplyGF256(uint8_t x, uint8_t y) {
+  int z = 0;
+  for(int i = 7; i >= 0; i--) {
+    z = (z << 1) ^ ((z >> 7) * 0x11D);
+    z ^= ((y >> i) & 1) * x;
+  }
+  return (uint8_t) z;
+}
+
+/**
+ * @brief Computes the Reed-Solomon ECC codewords of a block
+ */
+void computeReedSolomon(const uint8_t *data, int length, int degree, uint8_t *ecc) {
+  uint8_t divisor[32];
+  memset(divisor, 0, sizeof(divisor));
+  divisor[degree - 1] = 1;
+  uint8_t root = 1;
+  for(int i = 0; i < degree; i++) {
+    for(int j = 0; j < degree; j++) {
+      divisor[j] = multiplyGF256(divisor[j], root);
+      if(j + 1 < degree) divisor[j] ^= divisor[j + 1];
+    }
+    root = multiplyGF256(root, 0x02);
+  }
+
+  memset(ecc, 0, degree);
+  for(int i = 0; i < length; i++) {
+    uint8_t factor = data[i] ^ ecc[0];
+    memmove(ecc, ecc + 1, degree - 1);
+    ecc[degree - 1] = 0;
+    for(int j = 0; j < degree; j++)
+      ecc[j] ^= multiplyGF256(divisor[j], factor);
+  }
+}
+
+void setFunctionModule(QREncodedCode *code, int x, int y, bool dark) {
+  code->modules[y][x] = dark;
+  functionModules[y][x] = true;
+}
+
+void drawFinderPattern(QREncodedCode *code, int x, int y) {
+  for(int dy = -4; dy <= 4; dy++) {
+    for(int dx = -4; dx <= 4; dx++) {
+      int distance = dx * dx > dy * dy ? (dx < 0 ? -dx : dx) : (dy < 0 ? -dy : dy);
+      if(x + dx < 0 || x + dx >= code->size || y + dy < 0 || y + dy >= code->size) continue;
+      setFunctionModule(code, x + dx, y + dy, distance != 2 && distance != 4);
+    }
+  }
+}
+
+void drawAlignmentPattern(QREncodedCode *code, int x, int y) {
+  for(int dy = -2; dy <= 2; dy++) {
+    for(int dx = -2; dx <= 2; dx++) {
+      int distance = dx * dx > dy * dy ? (dx < 0 ? -dx : dx) : (dy < 0 ? -dy : dy);
+      setFunctionModule(code, x + dx, y + dy, distance != 1);
+    }
+  }
+}
+
+void drawFormatBits(QREncodedCode *code, int eccLevel, int mask) {
+  int data = QR_ECC_FORMAT_BITS[eccLevel] << 3 | mask;
+  int remainder = data;
+  for(int i = 0; i < 10; i++)
+    remainder = (remainder << 1) ^ ((remainder >> 9) * 0x537);
+  int bits = (data << 10 | remainder) ^ 0x5412;
+  int size = code->size;
+
+  for(int i = 0; i <= 5; i++)
+    setFunctionModule(code, 8, i, (bits >> i) & 1);
+  setFunctionModule(code, 8, 7, (bits >> 6) & 1);
+  setFunctionModule(code, 8, 8, (bits >> 7) & 1);
+  setFunctionModule(code, 7, 8, (bits >> 8) & 1);
+  for(int i = 9; i < 15; i++)
+    setFunctionModule(code, 14 - i, 8, (bits >> i) & 1);
+
+  for(int i = 0; i < 8; i++)
+    setFunctionModule(code, size - 1 - i, 8, (bits >> i) & 1);
+  for(int i = 8; i < 15; i++)
+    setFunctionModule(code, 8, size - 15 + i, (bits >> i) & 1);
+  setFunctionModule(code, 8, size - 8, true);
+}
+
+void drawVersionBits(QREncodedCode *code) {
+  if(code->version < 7) return;
+  int remainder = code->version;
+  for(int i = 0; i < 12; i++)
+    remainder = (remainder << 1) ^ ((remainder >> 11) * 0x1F25);
+  long bits = (long) code->version << 12 | remainder;
+  for(int i = 0; i < 18; i++) {
+    bool dark = (bits >> i) & 1;
+    int a = code->size - 11 + i % 3;
+    int b = i / 3;
+    setFunctionModule(code, a, b, dark);
+    setFunctionModule(code, b, a, dark);
+  }
+}
+
+void drawFunctionPatterns(QREncodedCode *code, int eccLevel, int mask) {
+  int size = code->size;
+  for(int i = 0; i < size; i++) {
+    setFunctionModule(code, 6, i, i % 2 == 0);
+    setFunctionModule(code, i, 6, i % 2 == 0);
+  }
+  drawFinderPattern(code, 3, 3);
+  drawFinderPattern(code, size - 4, 3);
+  drawFinderPattern(code, 3, size - 4);
+
+  if(code->version >= 2) {
+    int alignments = code->version / 7 + 2;
+    int step = (code->version * 4 + alignments * 2 + 1) / (alignments * 2 - 2) * 2;
+    int positions[7];
+    positions[0] = 6;
+    for(int i = alignments - 1, position = size - 7; i >= 1; i--, position -= step)
+      positions[i] = position;
+    for(int i = 0; i < alignments; i++) {
+      for(int j = 0; j < alignments; j++) {
+        /* the finder pattern corners */
+        if((i == 0 && j == 0) || (i == 0 && j == alignments - 1) || (i == alignments - 1 && j == 0)) continue;
+        drawAlignmentPattern(code, positions[i], positions[j]);
+      }
+    }
+  }
+  drawFormatBits(code, eccLevel, mask);
+  drawVersionBits(code);
+}
+
+bool getMaskBit(int mask, int x, int y) {
+  switch(mask) {
+    case 0: return (x + y) % 2 == 0;
+    case 1: return y % 2 == 0;
+    case 2: return x % 3 == 0;
+    case 3: return (x + y) % 3 == 0;
+    case 4: return (x / 3 + y / 2) % 2 == 0;
+    case 5: return x * y % 2 + x * y % 3 == 0;
+    case 6: return (x * y % 2 + x * y % 3) % 2 == 0;
+    default: return ((x + y) % 2 + x * y % 3) % 2 == 0;
+  }
+}
+
+/**
+ * @brief Encodes the data in byte mode, with a fixed version, ECC level and mask
+ * @param data The bytes to encode
+ * @param length The number of bytes
+ * @param version The QR Code version, 1 to QR_ENCODE_MAX_VERSION
+ * @param eccLevel The ECC level, QR_ECC_L to QR_ECC_H
+ * @param mask The mask pattern, 0 to 7
+ * @param [out] code The encoded modules
+ * @return True if the data fits the version and ECC level and false otherwise
+ */
+bool encodeQRCode(const uint8_t *data, int length, int version, int eccLevel, int mask, QREncodedCode *code) {
+  int capacity = getQRByteCapacity(version, eccLevel);
+  if(capacity < 0 || length > capacity || mask < 0 || mask > 7) return false;
+
+  /* data codewords: mode, count, bytes, terminator and pad bytes */
+  int dataCodewords = getDataCodewords(version, eccLevel);
+  uint8_t codewords[QR_MAX_CODEWORDS];
+  memset(codewords, 0, sizeof(codewords));
+  int bit = 0;
+  long fields[2][2] = {{0x4, 4}, {length, getCountBits(version)}};
+  for(int f = 0; f < 2; f++) {
+    for(int i = (int) fields[f][1] - 1; i >= 0; i--, bit++)
+      codewords[bit >> 3] |= ((fields[f][0] >> i) & 1) << (7 - (bit & 7));
+  }
+  for(int b = 0; b < length; b++) {
+    for(int i = 7; i >= 0; i--, bit++)
+      codewords[bit >> 3] |= ((data[b] >> i) & 1) << (7 - (bit & 7));
+  }
+  bit += dataCodewords * 8 - bit < 4 ? dataCodewords * 8 - bit : 4;
+  for(int i = (bit + 7) / 8, pad = 0xEC; i < dataCodewords; i++, pad ^= 0xEC ^ 0x11)
+    codewords[i] = pad;
+
+  /* ECC blocks, the short blocks first, interleaved */
+  int blocks = QR_ECC_BLOCKS[eccLevel][version];
+  int eccLength = QR_ECC_CODEWORDS_PER_BLOCK[eccLevel][version];
+  int rawCodewords = getRawDataModules(version) / 8;
+  int shortBlocks = blocks - rawCodewords % blocks;
+  int shortBlockLength = rawCodewords / blocks;
+  uint8_t blockData[QR_MAX_BLOCKS][QR_MAX_BLOCK_CODEWORDS];
+  uint8_t interleaved[QR_MAX_CODEWORDS];
+  for(int i = 0, offset = 0; i < blocks; i++) {
+    int blockDataLength = shortBlockLength - eccLength + (i < shortBlocks ? 0 : 1);
+    memcpy(blockData[i], codewords + offset, blockDataLength);
+    offset += blockDataLength;
+    computeReedSolomon(blockData[i], blockDataLength, eccLength, blockData[i] + shortBlockLength + 1 - eccLength);
+  }
+  int interleavedLength = 0;
+  for(int i = 0; i <= shortBlockLength; i++) {
+    for(int j = 0; j < blocks; j++) {
+      /* the short blocks have no codeword at the last data position */
+      if(i == shortBlockLength - eccLength && j < shortBlocks) continue;
+      interleaved[interleavedLength++] = blockData[j][i];
+    }
+  }
+
+  code->version = version;
+  code->size = 17 + 4 * version;
+  memset(code->modules, 0, sizeof(code->modules));
+  memset(functionModules, 0, sizeof(functionModules));
+  drawFunctionPatterns(code, eccLevel, mask);
+
+  /* zigzag placement, two columns at a time from the bottom right, skipping the timing column */
+  int i = 0;
+  for(int right = code->size - 1; right >= 1; right -= 2) {
+    if(right == 6) right = 5;
+    for(int vertical = 0; vertical < code->size; vertical++) {
+      for(int j = 0; j < 2; j++) {
+        int x = right - j;
+        bool upward = ((right + 1) & 2) == 0;
+        int y = upward ? code->size - 1 - vertical : vertical;
+        if(functionModules[y][x]) continue;
+        if(i < interleavedLength * 8) {
+          code->modules[y][x] = (interleaved[i >> 3] >> (7 - (i & 7))) & 1;
+          i++;
+        }
+        code->modules[y][x] ^= getMaskBit(mask, x, y);
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,19 @@
+#include <stdint.h>
+
+#define QR_ENCODE_MAX_VERSION 10
+#define QR_ENCODE_MAX_SIZE (17 + 4 * QR_ENCODE_MAX_VERSION)
+
+/* ECC levels, in the order of the capacity tables */
+#define QR_ECC_L 0
+#define QR_ECC_M 1
+#define QR_ECC_Q 2
+#define QR_ECC_H 3
+
+typedef struct {
+  int version;
+  int size;
+  bool modules[QR_ENCODE_MAX_SIZE][QR_ENCODE_MAX_SIZE]; /* [row][column], true is dark */
+} QREncodedCode;
+
+int getQRByteCapacity(int version, int eccLevel);
+bool encodeQRCode(const uint8_t *data, int length, int version, int eccLevel, int mask, QREncodedCode *code);